@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+// Define SPLAY_BLOCK_SCALAR to force the portable Block::rank, e.g. to
+// test it on a machine with SIMD or to compare against it. It must be
+// the same in every translation unit of a program.
+#if defined(SPLAY_BLOCK_SCALAR)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SPLAY_BLOCK_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPLAY_BLOCK_SSE2 1
+#endif
+
+namespace splay
+{
+
+// Sorted run of up to Capacity keys, searched with SIMD compares. Unused
+// slots hold INT_MAX so that a full-width compare never counts them.
+template <std::size_t Capacity>
+struct alignas(64) Block
+{
+    static_assert(Capacity >= 16 && Capacity <= 64 && Capacity % 8 == 0,
+        "block capacity must be a multiple of 8 within [16, 64]");
+
+    Block()
+    {
+        std::fill(keys, keys + Capacity, INT_MAX);
+    }
+
+    // Instruction set rank() was compiled for: "avx2", "sse2" or "scalar".
+#if defined(SPLAY_BLOCK_AVX2)
+    static constexpr const char* rank_kernel = "avx2";
+#elif defined(SPLAY_BLOCK_SSE2)
+    static constexpr const char* rank_kernel = "sse2";
+#else
+    static constexpr const char* rank_kernel = "scalar";
+#endif
+
+    int keys[Capacity];
+    int count { 0 };
+    Block* left { nullptr };
+    Block* right { nullptr };
+
+    int min() const
+    {
+        return keys[0];
+    }
+
+    int max() const
+    {
+        return keys[count - 1];
+    }
+
+    // Number of keys less than `key`, i.e. its insertion position.
+    int rank(int key) const
+    {
+#if defined(SPLAY_BLOCK_AVX2)
+        const __m256i probe = _mm256_set1_epi32(key);
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t i = 0; i < Capacity; i += 8)
+        {
+            const __m256i run = _mm256_load_si256(reinterpret_cast<const __m256i*>(keys + i));
+            // lanes with key > keys[i] are all ones, i.e. -1
+            acc = _mm256_sub_epi32(acc, _mm256_cmpgt_epi32(probe, run));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+#elif defined(SPLAY_BLOCK_SSE2)
+        const __m128i probe = _mm_set1_epi32(key);
+        __m128i acc = _mm_setzero_si128();
+        for (std::size_t i = 0; i < Capacity; i += 4)
+        {
+            const __m128i run = _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i));
+            acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(probe, run));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(acc);
+#else
+        int result = 0;
+        for (std::size_t i = 0; i < Capacity; ++i)
+            result += (key > keys[i]) ? 1 : 0;
+        return result;
+#endif
+    }
+}; // struct Block
+
+
+// Splay tree of int keys whose nodes are sorted key blocks rather than
+// single keys. The splay operates on blocks ordered by their key ranges,
+// so a tree of n keys is about Capacity times shallower, and the last
+// step of every lookup is a branch-free scan of one aligned block.
+//
+// insert/search/erase keep the semantics of splay::Tree: the accessed
+// block becomes the root, duplicates are rejected.
+template <std::size_t Capacity = 32>
+class BlockTree
+{
+public:
+    using Node = Block<Capacity>;
+
+    BlockTree() = default;
+
+    BlockTree(BlockTree&& other) noexcept
+        : root(other.root)
+        , size_(other.size_)
+        , splay_depth_(other.splay_depth_)
+    {
+        other.root = nullptr;
+        other.size_ = 0;
+    }
+
+    BlockTree& operator=(BlockTree&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            root = other.root;
+            size_ = other.size_;
+            splay_depth_ = other.splay_depth_;
+            other.root = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    BlockTree(const BlockTree&) = delete;
+    BlockTree& operator=(const BlockTree&) = delete;
+
+    ~BlockTree()
+    {
+        clear();
+    }
+
+    bool insert(int number)
+    {
+        if (!root)
+        {
+            root = new Node();
+            root->keys[0] = number;
+            root->count = 1;
+            ++size_;
+            return true;
+        }
+
+        // Whatever block the splay ends at may take the key: every key to
+        // its left is smaller and every key to its right is greater.
+        root = splay(number, root);
+
+        int pos = root->rank(number);
+        if (pos < root->count && root->keys[pos] == number)
+        {
+            // such value is already exist
+            return false;
+        }
+
+        if (root->count == static_cast<int>(Capacity))
+        {
+            // Move the upper half into a new block hung as the right child.
+            Node* upper = new Node();
+            const int half = static_cast<int>(Capacity) / 2;
+            std::copy(root->keys + half, root->keys + Capacity, upper->keys);
+            std::fill(root->keys + half, root->keys + Capacity, INT_MAX);
+            upper->count = static_cast<int>(Capacity) - half;
+            root->count = half;
+            upper->right = root->right;
+            root->right = upper;
+            if (pos > half)
+            {
+                insert_at(upper, pos - half, number);
+                ++size_;
+                return true;
+            }
+        }
+
+        insert_at(root, pos, number);
+        ++size_;
+        return true;
+    }
+
+    // Pointer to the stored key, or nullptr. Splays the block holding it
+    // (or the closest block) to the root.
+    const int* search(int number)
+    {
+        if (!root)
+            return nullptr;
+
+        root = splay(number, root);
+
+        const int pos = root->rank(number);
+        return (pos < root->count && root->keys[pos] == number) ? root->keys + pos : nullptr;
+    }
+
+    // Non-splaying lookup.
+    bool contains(int number) const
+    {
+        const Node* node = root;
+        while (node)
+        {
+            if (number < node->min())
+                node = node->left;
+            else if (number > node->max())
+                node = node->right;
+            else
+            {
+                const int pos = node->rank(number);
+                return pos < node->count && node->keys[pos] == number;
+            }
+        }
+        return false;
+    }
+
+    bool erase(int number)
+    {
+        if (!root)
+            return false;
+
+        root = splay(number, root);
+
+        const int pos = root->rank(number);
+        if (pos >= root->count || root->keys[pos] != number)
+            return false;
+
+        std::copy(root->keys + pos + 1, root->keys + root->count, root->keys + pos);
+        root->keys[--root->count] = INT_MAX;
+        --size_;
+
+        if (root->count == 0)
+        {
+            Node* temp = root;
+            if (!root->left)
+                root = root->right;
+            else
+            {
+                // every key on the left is less than `number`, so this
+                // brings the left maximum up with an empty right subtree
+                root = splay(number, root->left);
+                root->right = temp->right;
+            }
+            delete temp;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        while (root)
+        {
+            if (root->left)
+                root = RR_rotate(root);
+            else
+            {
+                Node* next = root->right;
+                delete root;
+                root = next;
+            }
+        }
+        size_ = 0;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    // Height in blocks.
+    int height() const
+    {
+        return height_(root);
+    }
+
+    // Total number of levels descended by all splays so far, as
+    // splay::Tree counts them but in blocks.
+    std::uint64_t splay_depth() const
+    {
+        return splay_depth_;
+    }
+
+    Node* get_root()
+    {
+        return root;
+    }
+
+private:
+    Node* root = {nullptr};
+    std::size_t size_ = 0;
+    std::uint64_t splay_depth_ = 0;
+
+    static void insert_at(Node* node, int pos, int number)
+    {
+        std::copy_backward(node->keys + pos, node->keys + node->count, node->keys + node->count + 1);
+        node->keys[pos] = number;
+        ++node->count;
+    }
+
+    int height_(const Node* node) const
+    {
+        if (!node)
+            return 0;
+        int left = (node->left) ? height_(node->left) : 0;
+        int right = (node->right) ? height_(node->right) : 0;
+        return  std::max(left + 1, right + 1);
+    }
+
+    Node* RR_rotate(Node* k2)
+    {
+        Node* k1 = k2->left;
+        k2->left = k1->right;
+        k1->right = k2;
+        return k1;
+    }
+
+    Node* LL_rotate(Node* k2)
+    {
+        Node* k1 = k2->right;
+        k2->right = k1->left;
+        k1->left = k2;
+        return k1;
+    }
+
+    // Top-down splay over key ranges: a block is "equal" to every key
+    // between its minimum and maximum.
+    Node* splay(int key, Node* node)
+    {
+        if (!node)
+            return nullptr;
+
+        Node* header_left = nullptr;
+        Node* header_right = nullptr;
+        Node** LeftTreeMax = &header_right;
+        Node** RightTreeMin = &header_left;
+        std::uint64_t depth = 0;
+        while (1)
+        {
+            if (key < node->min())
+            {
+                if (!node->left)
+                    break;
+                if (key < node->left->min())
+                {
+                    node = RR_rotate(node);
+                    ++depth;
+                    if (!node->left)
+                        break;
+                }
+                *RightTreeMin = node;
+                RightTreeMin = &node->left;
+                node = node->left;
+                ++depth;
+            }
+            else if (key > node->max())
+            {
+                if (!node->right)
+                    break;
+                if (key > node->right->max())
+                {
+                    node = LL_rotate(node);
+                    ++depth;
+                    if (!node->right)
+                        break;
+                }
+                *LeftTreeMax = node;
+                LeftTreeMax = &node->right;
+                node = node->right;
+                ++depth;
+            }
+            else
+                break;
+        }
+        splay_depth_ += depth;
+        *LeftTreeMax = node->left;
+        *RightTreeMin = node->right;
+        node->left = header_right;
+        node->right = header_left;
+        return node;
+    }
+}; // class BlockTree
+
+} // namespace splay
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "SplayBlockTree.h"
+#include "TestRandom.h"
+
+#include <climits>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace
+{
+    // Runs the same pseudo-random insert/search/erase sequence against the
+    // block tree and std::set.
+    template <std::size_t Capacity>
+    void CompareWithStdSet(int operations, int range)
+    {
+        splay::BlockTree<Capacity> tree;
+        std::set<int> expected;
+        for (const auto& step : test::RandomSteps(operations, range, 12345u))
+        {
+            const int key = step.key - range / 2;
+            switch (step.op)
+            {
+            case test::Op::Insert:
+                EXPECT_EQ(expected.insert(key).second, tree.insert(key));
+                break;
+            case test::Op::Search:
+            {
+                const int* found = tree.search(key);
+                EXPECT_EQ(expected.count(key) == 1, found != nullptr);
+                if (found)
+                {
+                    EXPECT_EQ(key, *found);
+                }
+                break;
+            }
+            case test::Op::Erase:
+                EXPECT_EQ(expected.erase(key) == 1, tree.erase(key));
+                break;
+            }
+            EXPECT_EQ(expected.size(), tree.size());
+        }
+        for (int key = -range / 2; key < range / 2; ++key)
+            EXPECT_EQ(expected.count(key) == 1, tree.contains(key));
+    }
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+TEST(SplayBlock, Rank)
+{
+    splay::Block<16> block;
+    for (int i = 0; i < 10; ++i)
+        block.keys[i] = i * 10;
+    block.count = 10;
+
+    EXPECT_EQ(0, block.rank(INT_MIN));
+    EXPECT_EQ(0, block.rank(0));
+    EXPECT_EQ(1, block.rank(5));
+    EXPECT_EQ(5, block.rank(50));
+    EXPECT_EQ(10, block.rank(91));
+    EXPECT_EQ(10, block.rank(INT_MAX));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlock, RankKernelFollowsBuildConfiguration)
+{
+    // DebugScalar and DebugAVX2 build the same tests for the other kernels
+#if defined(SPLAY_BLOCK_SCALAR)
+    EXPECT_STREQ("scalar", splay::Block<16>::rank_kernel);
+#elif defined(__AVX2__)
+    EXPECT_STREQ("avx2", splay::Block<16>::rank_kernel);
+#elif defined(__SSE2__) || defined(_M_X64)
+    EXPECT_STREQ("sse2", splay::Block<16>::rank_kernel);
+#endif
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlockTree, EmptyTree)
+{
+    splay::BlockTree<> tree;
+    EXPECT_EQ(nullptr, tree.get_root());
+    EXPECT_EQ(0, tree.height());
+    EXPECT_EQ(nullptr, tree.search(0));
+    EXPECT_FALSE(tree.contains(0));
+    EXPECT_FALSE(tree.erase(0));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlockTree, Insert_FillsOneBlockThenSplits)
+{
+    splay::BlockTree<16> tree;
+    for (int i = 0; i < 16; ++i)
+    {
+        EXPECT_TRUE(tree.insert(i));
+        EXPECT_FALSE(tree.insert(i));
+    }
+    EXPECT_EQ(1, tree.height());
+    EXPECT_EQ(16, tree.get_root()->count);
+    EXPECT_EQ(0u, tree.splay_depth());
+
+    EXPECT_TRUE(tree.insert(16));
+    EXPECT_EQ(2, tree.height());
+    EXPECT_EQ(17u, tree.size());
+    for (int i = 0; i <= 16; ++i)
+        EXPECT_TRUE(tree.contains(i));
+
+    // the other block is one level down
+    const std::uint64_t depth = tree.splay_depth();
+    EXPECT_NE(nullptr, tree.search(tree.get_root()->min() == 0 ? 16 : 0));
+    EXPECT_EQ(depth + 1, tree.splay_depth());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlockTree, ExtremeKeys)
+{
+    splay::BlockTree<> tree;
+    EXPECT_FALSE(tree.contains(INT_MAX));
+    EXPECT_TRUE(tree.insert(0));
+    EXPECT_FALSE(tree.contains(INT_MAX));
+    EXPECT_EQ(nullptr, tree.search(INT_MAX));
+
+    EXPECT_TRUE(tree.insert(INT_MAX));
+    EXPECT_TRUE(tree.insert(INT_MIN));
+    EXPECT_TRUE(tree.contains(INT_MAX));
+    EXPECT_TRUE(tree.contains(INT_MIN));
+    EXPECT_TRUE(tree.erase(INT_MAX));
+    EXPECT_FALSE(tree.contains(INT_MAX));
+    EXPECT_EQ(2u, tree.size());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlockTree, Erase_EmptiedBlocksAreFreed)
+{
+    splay::BlockTree<16> tree;
+    for (int i = 0; i < 160; ++i)
+        EXPECT_TRUE(tree.insert(i));
+    for (int i = 0; i < 160; ++i)
+        EXPECT_TRUE(tree.erase(i));
+    EXPECT_EQ(nullptr, tree.get_root());
+    EXPECT_EQ(0u, tree.size());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBlockTree, CompareWithStdSet)
+{
+    CompareWithStdSet<16>(20000, 2000);
+    CompareWithStdSet<32>(20000, 2000);
+    CompareWithStdSet<64>(20000, 5000);
+}
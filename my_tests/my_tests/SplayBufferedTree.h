@@ -0,0 +1,148 @@
+#pragma once
+
+#include "SplayTree.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace splay
+{
+
+// Write-optimized front end of splay::BasicTree for insert bursts.
+//
+// insert() and erase() are blind writes: they append to a small log
+// (erases as tombstones) instead of splaying. Lookups check the log, newest
+// entry first, before the tree, so a write is visible at once. When the
+// log reaches `threshold` entries it is sorted, reduced to the last write
+// of every key and applied to the tree in key order; sequential splays
+// keep each of those applications close to constant time.
+template <typename T, typename Compare = std::less<T>>
+class BufferedTree
+{
+public:
+    using TreeType = BasicTree<T, Compare>;
+
+    static constexpr std::size_t default_threshold = 256;
+
+    explicit BufferedTree(std::size_t threshold = default_threshold, const Compare& comp = Compare())
+        : tree(comp)
+        , comp(comp)
+        , threshold(std::max<std::size_t>(threshold, 1))
+    {
+        log.reserve(this->threshold);
+    }
+
+    void insert(const T& number)
+    {
+        append(number, false);
+    }
+
+    void erase(const T& number)
+    {
+        append(number, true);
+    }
+
+    // Non-splaying lookup.
+    bool contains(const T& number) const
+    {
+        bool erased = false;
+        if (find_in_log(number, erased))
+            return !erased;
+        return tree.contains(number);
+    }
+
+    // Lookup that splays the tree when the log does not decide it.
+    bool search(const T& number)
+    {
+        bool erased = false;
+        if (find_in_log(number, erased))
+            return !erased;
+        return tree.search(number) != nullptr;
+    }
+
+    // Applies the log to the tree.
+    void flush()
+    {
+        if (log.empty())
+            return;
+
+        // keep the last write of each key
+        std::stable_sort(log.begin(), log.end(), [this](const Entry& a, const Entry& b) {
+            return comp(a.number, b.number);
+        });
+        for (std::size_t i = 0; i < log.size(); ++i)
+        {
+            if (i + 1 < log.size() && !comp(log[i].number, log[i + 1].number))
+                continue;
+
+            if (log[i].erased)
+                tree.erase(log[i].number);
+            else
+                tree.insert(std::move(log[i].number));
+        }
+
+        ++merges_;
+        log.clear();
+    }
+
+    std::size_t pending() const
+    {
+        return log.size();
+    }
+
+    std::uint64_t merges() const
+    {
+        return merges_;
+    }
+
+    // Splay depth of the tree behind the log; lookups answered by the log
+    // add nothing.
+    std::uint64_t splay_depth() const
+    {
+        return tree.splay_depth();
+    }
+
+    // The tree behind the log; flush() first for a complete view.
+    TreeType& get_tree()
+    {
+        return tree;
+    }
+
+private:
+    struct Entry
+    {
+        T number;
+        bool erased;
+    }; // struct Entry
+
+    TreeType tree;
+    Compare comp;
+    std::size_t threshold;
+    std::vector<Entry> log;
+    std::uint64_t merges_ = 0;
+
+    void append(const T& number, bool erased)
+    {
+        log.push_back(Entry{ number, erased });
+        if (log.size() >= threshold)
+            flush();
+    }
+
+    bool find_in_log(const T& number, bool& erased) const
+    {
+        for (std::size_t i = log.size(); i-- > 0;)
+        {
+            if (!comp(number, log[i].number) && !comp(log[i].number, number))
+            {
+                erased = log[i].erased;
+                return true;
+            }
+        }
+        return false;
+    }
+}; // class BufferedTree
+
+} // namespace splay
@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "SplayBufferedTree.h"
+#include "TestRandom.h"
+
+#include <set>
+#include <vector>
+
+// ------------------------------------------------------------------------
+TEST(SplayBufferedTree, ReadAfterWrite)
+{
+    // Initialization
+    splay::BufferedTree<int> tree(8);
+    EXPECT_FALSE(tree.contains(1));
+
+    // -----------------
+    tree.insert(1);
+    tree.insert(2);
+    EXPECT_EQ(2u, tree.pending());
+    EXPECT_TRUE(tree.contains(1));
+    EXPECT_TRUE(tree.search(2));
+    EXPECT_EQ(nullptr, tree.get_tree().get_root());
+
+    tree.erase(1);
+    EXPECT_FALSE(tree.contains(1));
+    tree.insert(1);
+    EXPECT_TRUE(tree.contains(1));
+
+    tree.flush();
+    EXPECT_EQ(0u, tree.pending());
+    EXPECT_EQ(1u, tree.merges());
+    EXPECT_TRUE(tree.get_tree().contains(1));
+    EXPECT_TRUE(tree.get_tree().contains(2));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBufferedTree, TombstoneShadowsTree)
+{
+    // Initialization
+    splay::BufferedTree<int> tree(8);
+    tree.insert(5);
+    tree.flush();
+
+    // -----------------
+    tree.erase(5);
+    EXPECT_FALSE(tree.contains(5));
+    EXPECT_FALSE(tree.search(5));
+    EXPECT_TRUE(tree.get_tree().contains(5));
+
+    // a tombstone of an absent key is harmless
+    tree.erase(6);
+    tree.flush();
+    EXPECT_FALSE(tree.get_tree().contains(5));
+    EXPECT_FALSE(tree.contains(6));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBufferedTree, ThresholdTriggersMerge)
+{
+    // Initialization
+    splay::BufferedTree<int> tree(4);
+
+    // -----------------
+    for (int i = 0; i < 3; ++i)
+        tree.insert(i);
+    EXPECT_EQ(0u, tree.merges());
+    tree.insert(3);
+    EXPECT_EQ(1u, tree.merges());
+    EXPECT_EQ(0u, tree.pending());
+
+    // keys arrive unsorted and end up in order
+    for (int i = 100; i > 0; --i)
+        tree.insert(i * 3 % 101);
+    tree.flush();
+    for (int i = 0; i <= 100; ++i)
+        EXPECT_TRUE(tree.contains(i));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayBufferedTree, MatchesSet)
+{
+    // Initialization
+    splay::BufferedTree<int> tree(64);
+    std::set<int> expected;
+
+    // -----------------
+    for (const auto& step : test::RandomSteps(20000, 1000, 12u))
+    {
+        const int key = step.key;
+        switch (step.op)
+        {
+        case test::Op::Insert:
+            tree.insert(key);
+            expected.insert(key);
+            break;
+        case test::Op::Erase:
+            tree.erase(key);
+            expected.erase(key);
+            break;
+        case test::Op::Search:
+            EXPECT_EQ(expected.count(key) == 1, tree.search(key));
+            break;
+        }
+    }
+    for (int key = 0; key < 1000; ++key)
+        EXPECT_EQ(expected.count(key) == 1, tree.contains(key));
+    EXPECT_GT(tree.merges(), 0u);
+}
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace splay
+{
+
+struct ConcurrentNode
+{
+    ConcurrentNode(int n, std::uint64_t v)
+        : number(n)
+        , version(v)
+    {
+    }
+
+    int number { 0 };
+    ConcurrentNode* left { nullptr };
+    ConcurrentNode* right { nullptr };
+    std::uint64_t version { 0 };    // write operation that created the node
+}; // struct ConcurrentNode
+
+
+// Splay tree of int keys with lock-free readers.
+//
+// Writers (insert/search/erase) are serialized by a mutex and splay as
+// splay::Tree does, except that a node is never changed once readers can
+// see it: every node a splay touches is replaced by a copy, and the new
+// root is published with one atomic store. A reader loads the root and
+// walks an immutable snapshot, so contains() on a Reader takes no lock,
+// writes no shared memory and finishes in O(height) steps whatever the
+// writers do.
+//
+// Replaced nodes are retired and freed by epoch-based reclamation: a
+// reader announces the epoch in its own slot while it walks, the writer
+// advances the epoch only when every active reader has seen the current
+// one, and a node retired in epoch e is freed once the epoch reaches e + 2.
+class ConcurrentTree
+{
+public:
+    using Node = ConcurrentNode;
+
+    // Readers that may be active at the same time.
+    static constexpr std::size_t max_readers = 128;
+
+    // Lock-free read access from one thread. Holds a reader slot of the
+    // tree until destroyed; constructing one waits while all are taken.
+    class Reader
+    {
+    public:
+        explicit Reader(const ConcurrentTree& tree)
+            : tree(tree)
+            , slot(tree.acquire_slot())
+        {
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader()
+        {
+            tree.slots[slot].in_use.store(false, std::memory_order_release);
+        }
+
+        bool contains(int number) const
+        {
+            return contains(number, [](const Node*) {});
+        }
+
+        // As contains(), calling visit(node) on every node of the path
+        // while the epoch is announced: the whole snapshot stays alive
+        // during the calls, whatever the writers do meanwhile.
+        template <typename Visit>
+        bool contains(int number, Visit visit) const
+        {
+            std::atomic<std::uint64_t>& active = tree.slots[slot].epoch;
+            active.store(tree.epoch.load());
+            const Node* node = tree.root.load();
+            while (node)
+            {
+                visit(node);
+                if (node->number == number)
+                    break;
+                node = (number < node->number) ? node->left : node->right;
+            }
+            active.store(0, std::memory_order_release);
+            return node != nullptr;
+        }
+
+    private:
+        const ConcurrentTree& tree;
+        std::size_t slot;
+    }; // class Reader
+
+    ConcurrentTree() = default;
+
+    ConcurrentTree(const ConcurrentTree&) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+
+    // No reader may be active any more.
+    ~ConcurrentTree()
+    {
+        for (const auto& node : retired)
+            delete node.first;
+
+        Node* node = root.load(std::memory_order_relaxed);
+        while (node)
+        {
+            if (node->left)
+            {
+                Node* k1 = node->left;
+                node->left = k1->right;
+                k1->right = node;
+                node = k1;
+            }
+            else
+            {
+                Node* next = node->right;
+                delete node;
+                node = next;
+            }
+        }
+    }
+
+    bool insert(int number)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        ++version;
+
+        Node* node = splay(number, root.load(std::memory_order_relaxed));
+        bool inserted = true;
+        if (!node)
+            node = new Node(number, version);
+        else if (number < node->number)
+        {
+            Node* new_node = new Node(number, version);
+            new_node->left = node->left;
+            new_node->right = node;
+            node->left = nullptr;
+            node = new_node;
+        }
+        else if (number > node->number)
+        {
+            Node* new_node = new Node(number, version);
+            new_node->right = node->right;
+            new_node->left = node;
+            node->right = nullptr;
+            node = new_node;
+        }
+        else
+        {
+            // such value is already exist
+            inserted = false;
+        }
+
+        publish(node);
+        return inserted;
+    }
+
+    // Splaying lookup; it copies the access path like any other write.
+    bool search(int number)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        ++version;
+
+        Node* node = splay(number, root.load(std::memory_order_relaxed));
+        publish(node);
+        return node && node->number == number;
+    }
+
+    bool erase(int number)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        ++version;
+
+        Node* node = splay(number, root.load(std::memory_order_relaxed));
+        if (!node || node->number != number)
+        {
+            publish(node);
+            return false;
+        }
+
+        Node* next = node->right;
+        if (node->left)
+        {
+            // every key on the left is less than `number`, so this brings
+            // the left maximum up with an empty right subtree
+            next = splay(number, node->left);
+            next->right = node->right;
+        }
+        publish(next);
+
+        // `node` is a copy made by this operation: no reader has seen it
+        delete node;
+        return true;
+    }
+
+    // Non-splaying lookup through a short-lived Reader.
+    bool contains(int number) const
+    {
+        return Reader(*this).contains(number);
+    }
+
+    // Nodes waiting for the readers to move on.
+    std::size_t retired_nodes() const
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        return retired.size();
+    }
+
+    int height() const
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        return height_(root.load(std::memory_order_relaxed));
+    }
+
+    const Node* get_root() const
+    {
+        return root.load(std::memory_order_acquire);
+    }
+
+private:
+    // One cache line per reader, so that readers do not share writes.
+    struct alignas(64) Slot
+    {
+        std::atomic<bool> in_use { false };
+        std::atomic<std::uint64_t> epoch { 0 };     // 0 while not reading
+    }; // struct Slot
+
+    std::atomic<Node*> root { nullptr };
+    std::atomic<std::uint64_t> epoch { 1 };
+    mutable Slot slots[max_readers];
+
+    // Writer state.
+    mutable std::mutex writer;
+    std::uint64_t version = 0;
+    std::vector<std::pair<Node*, std::uint64_t>> retired;   // node, epoch; oldest first
+
+    std::size_t acquire_slot() const
+    {
+        for (;;)
+        {
+            for (std::size_t i = 0; i < max_readers; ++i)
+            {
+                bool expected = false;
+                if (!slots[i].in_use.load(std::memory_order_relaxed)
+                    && slots[i].in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    return i;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // The node itself if this operation made it, otherwise a copy that
+    // replaces it; the original is retired.
+    Node* fresh(Node* node)
+    {
+        if (node->version == version)
+            return node;
+
+        Node* copy = new Node(node->number, version);
+        copy->left = node->left;
+        copy->right = node->right;
+        retired.emplace_back(node, epoch.load(std::memory_order_relaxed));
+        return copy;
+    }
+
+    Node* fresh_left(Node* node)
+    {
+        return node->left = fresh(node->left);
+    }
+
+    Node* fresh_right(Node* node)
+    {
+        return node->right = fresh(node->right);
+    }
+
+    // Top-down splay of splay::Tree on fresh nodes only. Subtrees that are
+    // merely relinked stay shared with the published tree.
+    Node* splay(int key, Node* node)
+    {
+        if (!node)
+            return nullptr;
+
+        node = fresh(node);
+        Node header(0, version);
+        Node* LeftTreeMax = &header;
+        Node* RightTreeMin = &header;
+        while (1)
+        {
+            if (key < node->number)
+            {
+                if (!node->left)
+                    break;
+                Node* k1 = fresh_left(node);
+                if (key < k1->number)
+                {
+                    node->left = k1->right;
+                    k1->right = node;
+                    node = k1;
+                    if (!node->left)
+                        break;
+                    fresh_left(node);
+                }
+                RightTreeMin->left = node;
+                RightTreeMin = node;
+                node = node->left;
+            }
+            else if (key > node->number)
+            {
+                if (!node->right)
+                    break;
+                Node* k1 = fresh_right(node);
+                if (key > k1->number)
+                {
+                    node->right = k1->left;
+                    k1->left = node;
+                    node = k1;
+                    if (!node->right)
+                        break;
+                    fresh_right(node);
+                }
+                LeftTreeMax->right = node;
+                LeftTreeMax = node;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        LeftTreeMax->right = node->left;
+        RightTreeMin->left = node->right;
+        node->left = header.right;
+        node->right = header.left;
+        return node;
+    }
+
+    // Makes the result of a write visible and frees what no reader can
+    // reach any more.
+    void publish(Node* node)
+    {
+        root.store(node);
+
+        const std::uint64_t current = epoch.load(std::memory_order_relaxed);
+        bool quiet = true;
+        for (const auto& slot : slots)
+        {
+            const std::uint64_t active = slot.epoch.load();
+            if (active != 0 && active != current)
+            {
+                quiet = false;
+                break;
+            }
+        }
+        if (quiet)
+            epoch.store(current + 1);
+
+        const std::uint64_t safe = epoch.load(std::memory_order_relaxed);
+        std::size_t freed = 0;
+        while (freed < retired.size() && retired[freed].second + 2 <= safe)
+            delete retired[freed++].first;
+        retired.erase(retired.begin(), retired.begin() + freed);
+    }
+
+    static int height_(const Node* node)
+    {
+        if (!node)
+            return 0;
+        int left = (node->left) ? height_(node->left) : 0;
+        int right = (node->right) ? height_(node->right) : 0;
+        return  std::max(left + 1, right + 1);
+    }
+}; // class ConcurrentTree
+
+} // namespace splay
@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "SplayConcurrentTree.h"
+#include "TestRandom.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Checks the key order below `node`.
+    bool IsOrdered(const splay::ConcurrentNode* node, long long low, long long high)
+    {
+        if (!node)
+            return true;
+        if (node->number <= low || node->number >= high)
+            return false;
+        return IsOrdered(node->left, low, node->number) && IsOrdered(node->right, node->number, high);
+    }
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+TEST(SplayConcurrentTree, SplaysLikeTree)
+{
+    // Initialization
+    // (1) - (2) - ... - (64): a spine, as in splay::Tree
+    splay::ConcurrentTree tree;
+    for (int i = 64; i >= 1; --i)
+        EXPECT_TRUE(tree.insert(i));
+    EXPECT_EQ(64, tree.height());
+    EXPECT_FALSE(tree.insert(64));
+
+    // -----------------
+    EXPECT_TRUE(tree.search(64));
+    EXPECT_EQ(64, tree.get_root()->number);
+    EXPECT_GT(64, tree.height());
+    EXPECT_FALSE(tree.search(100));
+
+    EXPECT_TRUE(tree.erase(32));
+    EXPECT_FALSE(tree.erase(32));
+    EXPECT_FALSE(tree.contains(32));
+    EXPECT_TRUE(tree.contains(31));
+    EXPECT_TRUE(IsOrdered(tree.get_root(), 0, 65));
+
+    // nothing was reading: only the root replaced by the last insert
+    // waits for the next epoch
+    tree.insert(0);
+    tree.insert(-1);
+    EXPECT_EQ(1u, tree.retired_nodes());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayConcurrentTree, MatchesSet)
+{
+    // Initialization
+    splay::ConcurrentTree tree;
+    std::set<int> expected;
+
+    // -----------------
+    for (const auto& step : test::RandomSteps(20000, 500, 13u))
+    {
+        const int key = step.key;
+        switch (step.op)
+        {
+        case test::Op::Insert:
+            EXPECT_EQ(expected.insert(key).second, tree.insert(key));
+            break;
+        case test::Op::Erase:
+            EXPECT_EQ(expected.erase(key) == 1, tree.erase(key));
+            break;
+        case test::Op::Search:
+            EXPECT_EQ(expected.count(key) == 1, tree.search(key));
+            break;
+        }
+    }
+    for (int key = 0; key < 500; ++key)
+        EXPECT_EQ(expected.count(key) == 1, tree.contains(key));
+    EXPECT_TRUE(IsOrdered(tree.get_root(), -1, 500));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayConcurrentTree, ReaderHoldsOffReclamation)
+{
+    // Initialization
+    splay::ConcurrentTree tree;
+    for (int i = 0; i < 100; ++i)
+        tree.insert(i);
+
+    // -----------------
+    // a snapshot taken by a reader stays alive while the reader reads
+    splay::ConcurrentTree::Reader reader(tree);
+    std::atomic<bool> stop{ false };
+    std::thread writer([&tree, &stop]() {
+        for (int i = 0; !stop; i = (i + 37) % 100)
+            tree.search(i);
+    });
+    for (int i = 0; i < 20000; ++i)
+        EXPECT_TRUE(reader.contains(i % 100));
+    stop = true;
+    writer.join();
+
+    tree.search(0);
+    tree.search(1);
+    EXPECT_GT(200u, tree.retired_nodes());
+
+    // a reader in the middle of a walk keeps every node retired since it
+    // began: each search retires at least the old root, none is freed
+    std::size_t held = 0;
+    int visits = 0;
+    EXPECT_TRUE(reader.contains(50, [&tree, &held, &visits](const splay::ConcurrentNode* node) {
+        if (visits++)
+            return;
+        const int number = node->number;
+        for (int i = 0; i < 100; ++i)
+            tree.search((i * 37) % 100);
+        held = tree.retired_nodes();
+        EXPECT_EQ(number, node->number);
+    }));
+    EXPECT_LE(100u, held);
+
+    // two epochs after the walk they are all gone
+    tree.search(0);
+    tree.search(1);
+    EXPECT_GT(held, tree.retired_nodes());
+    EXPECT_GT(200u, tree.retired_nodes());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayConcurrentTree, Stress32Readers)
+{
+    // Initialization
+    // even keys stay, odd keys come and go, negative keys never exist
+    splay::ConcurrentTree tree;
+    for (int i = 0; i < 2000; i += 2)
+        tree.insert(i);
+
+    // -----------------
+    std::atomic<bool> stop{ false };
+    std::atomic<int> failures{ 0 };
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < 32; ++t)
+    {
+        readers.emplace_back([&tree, &stop, &failures, t]() {
+            splay::ConcurrentTree::Reader reader(tree);
+            test::Random random(t);
+            while (!stop)
+            {
+                const int key = static_cast<int>(random.next(1000)) * 2;
+                if (!reader.contains(key) || reader.contains(-key - 1))
+                    ++failures;
+                reader.contains(key + 1);
+            }
+        });
+    }
+
+    test::Random random(14u);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int key = static_cast<int>(random.next(1000)) * 2 + 1;
+        if (i % 2)
+            tree.insert(key);
+        else
+            tree.erase(key);
+        tree.search(key - 1);
+    }
+    stop = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    EXPECT_EQ(0, failures);
+    EXPECT_TRUE(IsOrdered(tree.get_root(), -1, 2001));
+    for (int i = 0; i < 2000; i += 2)
+        EXPECT_TRUE(tree.contains(i));
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace splay
+{
+
+// Shape of a whole tree, from depth_summary().
+struct DepthSummary
+{
+    std::size_t nodes = 0;
+    int height = 0;
+    double mean_depth = 0;              // the root is at depth 0
+    std::vector<std::size_t> per_depth; // number of nodes at each depth
+    int longest_spine = 0;              // most links in a row going the same way
+}; // struct DepthSummary
+
+namespace detail
+{
+
+template <typename NodeT>
+struct ShapeItem
+{
+    const NodeT* node;
+    int depth;
+    int run;        // length of the same-direction run ending at the node
+    bool left;      // direction of the link into the node
+}; // struct ShapeItem
+
+template <typename NodeT>
+std::size_t subtree_size(const NodeT* node)
+{
+    std::size_t size = 0;
+    std::vector<const NodeT*> stack;
+    if (node)
+        stack.push_back(node);
+    while (!stack.empty())
+    {
+        const NodeT* next = stack.back();
+        stack.pop_back();
+        ++size;
+        if (next->left)
+            stack.push_back(next->left);
+        if (next->right)
+            stack.push_back(next->right);
+    }
+    return size;
+}
+
+// The key as streamed by operator<<.
+template <typename T>
+std::string key_text(const T& key)
+{
+    std::ostringstream text;
+    text << key;
+    return text.str();
+}
+
+// A JSON string: quotes and backslashes escaped, control characters
+// written as \n, \t, \r or \u00XX.
+inline std::string json_quoted(const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string result = "\"";
+    for (const char c : text)
+    {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c == '\n')
+            result += "\\n";
+        else if (c == '\t')
+            result += "\\t";
+        else if (c == '\r')
+            result += "\\r";
+        else if (byte < 0x20)
+        {
+            result += "\\u00";
+            result += hex[byte >> 4];
+            result += hex[byte & 0xf];
+        }
+        else
+            result += c;
+    }
+    return result + '"';
+}
+
+// A DOT string. DOT has no escapes for control characters (\n, \l and \r
+// are line breaks in labels), so they are shown as the text \n, \t, \r
+// or \xXX, which keeps one line per node and tells the keys apart.
+inline std::string dot_quoted(const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string result = "\"";
+    for (const char c : text)
+    {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"')
+            result += "\\\"";
+        else if (c == '\\')
+            result += "\\\\";
+        else if (c == '\n')
+            result += "\\\\n";
+        else if (c == '\t')
+            result += "\\\\t";
+        else if (c == '\r')
+            result += "\\\\r";
+        else if (byte < 0x20)
+        {
+            result += "\\\\x";
+            result += hex[byte >> 4];
+            result += hex[byte & 0xf];
+        }
+        else
+            result += c;
+    }
+    return result + '"';
+}
+
+template <typename T>
+constexpr bool is_char_like()
+{
+    return std::is_same<T, char>::value || std::is_same<T, signed char>::value
+        || std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value
+        || std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value;
+}
+
+// A JSON value for the key: numbers stay numbers, bool becomes true or
+// false, characters are written as their code, anything else as a string.
+template <typename T>
+void write_key(std::ostream& out, const T& key)
+{
+    if constexpr (std::is_same<T, bool>::value)
+        out << (key ? "true" : "false");
+    else if constexpr (is_char_like<T>())
+        out << static_cast<long long>(key);
+    else if constexpr (std::is_arithmetic<T>::value)
+        out << key;
+    else
+        out << json_quoted(key_text(key));
+}
+
+// Nodes of the top `levels` levels in breadth-first order.
+template <typename NodeT>
+std::vector<const NodeT*> top_levels(const NodeT* root, int levels)
+{
+    std::vector<const NodeT*> nodes;
+    std::vector<int> depths;
+    if (root && levels > 0)
+    {
+        nodes.push_back(root);
+        depths.push_back(0);
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (depths[i] + 1 >= levels)
+            continue;
+        for (const NodeT* child : { nodes[i]->left, nodes[i]->right })
+        {
+            if (child)
+            {
+                nodes.push_back(child);
+                depths.push_back(depths[i] + 1);
+            }
+        }
+    }
+    return nodes;
+}
+
+} // namespace detail
+
+
+// Walks the whole tree iteratively; nothing is splayed, so it is safe on
+// a live tree between operations. Works with any node that has `left` and
+// `right` pointers.
+template <typename NodeT>
+DepthSummary depth_summary(const NodeT* root)
+{
+    DepthSummary summary;
+    double depth_sum = 0;
+    std::vector<detail::ShapeItem<NodeT>> stack;
+    if (root)
+        stack.push_back({ root, 0, 0, false });
+    while (!stack.empty())
+    {
+        const auto item = stack.back();
+        stack.pop_back();
+
+        ++summary.nodes;
+        depth_sum += item.depth;
+        if (summary.per_depth.size() <= static_cast<std::size_t>(item.depth))
+            summary.per_depth.resize(item.depth + 1, 0);
+        ++summary.per_depth[item.depth];
+        summary.height = std::max(summary.height, item.depth + 1);
+        summary.longest_spine = std::max(summary.longest_spine, item.run);
+
+        if (item.node->left)
+            stack.push_back({ item.node->left, item.depth + 1, (item.run && item.left) ? item.run + 1 : 1, true });
+        if (item.node->right)
+            stack.push_back({ item.node->right, item.depth + 1, (item.run && !item.left) ? item.run + 1 : 1, false });
+    }
+    if (summary.nodes)
+        summary.mean_depth = depth_sum / summary.nodes;
+    return summary;
+}
+
+// Graphviz DOT of the top `levels` levels. A subtree cut off below them is
+// drawn as one box labelled with its size; the graph label carries the
+// depth summary of the whole tree.
+//
+//     splay::write_dot(file, tree.get_root(), 6);
+//     dot -Tsvg tree.dot > tree.svg
+template <typename NodeT>
+void write_dot(std::ostream& out, const NodeT* root, int levels = 8)
+{
+    const DepthSummary summary = depth_summary(root);
+    const std::vector<const NodeT*> nodes = detail::top_levels(root, levels);
+
+    out << "digraph splay {\n"
+        << "    label=\"nodes " << summary.nodes
+        << ", height " << summary.height
+        << ", mean depth " << summary.mean_depth
+        << ", longest spine " << summary.longest_spine << "\";\n"
+        << "    node [shape=circle];\n";
+
+    std::size_t next_id = 0;
+    std::size_t child = 1;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        out << "    n" << i << " [label=" << detail::dot_quoted(detail::key_text(nodes[i]->number)) << "];\n";
+        for (const NodeT* link : { nodes[i]->left, nodes[i]->right })
+        {
+            if (!link)
+                continue;
+            if (child < nodes.size() && nodes[child] == link)
+                out << "    n" << i << " -> n" << child++ << ";\n";
+            else
+            {
+                out << "    c" << next_id << " [shape=box, label=\"+" << detail::subtree_size(link) << "\"];\n"
+                    << "    n" << i << " -> c" << next_id << ";\n";
+                ++next_id;
+            }
+        }
+    }
+    out << "}\n";
+}
+
+// JSON of the same view: the top levels as a flat list of nodes linked by
+// index (null for no child, {"cut": size} for a cut off subtree), then
+// the depth summary of the whole tree.
+template <typename NodeT>
+void write_json(std::ostream& out, const NodeT* root, int levels = 8)
+{
+    const DepthSummary summary = depth_summary(root);
+    const std::vector<const NodeT*> nodes = detail::top_levels(root, levels);
+
+    out << "{\"nodes\":[";
+    std::size_t child = 1;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        out << (i ? "," : "") << "{\"key\":";
+        detail::write_key(out, nodes[i]->number);
+        for (int side = 0; side < 2; ++side)
+        {
+            const NodeT* link = side ? nodes[i]->right : nodes[i]->left;
+            out << (side ? ",\"right\":" : ",\"left\":");
+            if (!link)
+                out << "null";
+            else if (child < nodes.size() && nodes[child] == link)
+                out << child++;
+            else
+                out << "{\"cut\":" << detail::subtree_size(link) << "}";
+        }
+        out << "}";
+    }
+
+    out << "],\"summary\":{\"nodes\":" << summary.nodes
+        << ",\"height\":" << summary.height
+        << ",\"mean_depth\":" << summary.mean_depth
+        << ",\"longest_spine\":" << summary.longest_spine
+        << ",\"per_depth\":[";
+    for (std::size_t d = 0; d < summary.per_depth.size(); ++d)
+        out << (d ? "," : "") << summary.per_depth[d];
+    out << "]}}\n";
+}
+
+} // namespace splay
@@ -0,0 +1,182 @@
+#include "gtest/gtest.h"
+#include "SplayExport.h"
+#include "SplayTree.h"
+#include "SplayWeightedTree.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, EmptyTree)
+{
+    splay::Tree tree;
+    const splay::DepthSummary summary = splay::depth_summary(tree.get_root());
+    EXPECT_EQ(0u, summary.nodes);
+    EXPECT_EQ(0, summary.height);
+    EXPECT_TRUE(summary.per_depth.empty());
+
+    std::ostringstream json;
+    splay::write_json(json, tree.get_root());
+    EXPECT_EQ("{\"nodes\":[],\"summary\":{\"nodes\":0,\"height\":0,\"mean_depth\":0,\"longest_spine\":0,\"per_depth\":[]}}\n", json.str());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, SummaryShowsSpine)
+{
+    // Initialization
+    // (64) - (63) - ... - (1): the spine of Insert_Right, grown to 64 keys
+    splay::Tree tree;
+    for (int i = 1; i <= 64; ++i)
+        tree.insert(i);
+    const splay::Node* root = tree.get_root();
+
+    // -----------------
+    const splay::DepthSummary summary = splay::depth_summary(tree.get_root());
+    EXPECT_EQ(root, tree.get_root());
+    EXPECT_EQ(64u, summary.nodes);
+    EXPECT_EQ(64, summary.height);
+    EXPECT_EQ(63, summary.longest_spine);
+    EXPECT_DOUBLE_EQ(31.5, summary.mean_depth);
+    EXPECT_EQ(std::vector<std::size_t>(64, 1), summary.per_depth);
+
+    // a balanced tree of the same keys
+    std::vector<int> keys;
+    for (int i = 1; i <= 63; ++i)
+        keys.push_back(i);
+    tree.assign(keys);
+    const splay::DepthSummary balanced = splay::depth_summary(tree.get_root());
+    EXPECT_EQ(6, balanced.height);
+    EXPECT_EQ(5, balanced.longest_spine);
+    EXPECT_EQ((std::vector<std::size_t>{ 1, 2, 4, 8, 16, 32 }), balanced.per_depth);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, DotCutsDeepLevels)
+{
+    // Initialization
+    //       (4)
+    //      /   \
+    //    (2)   (6)
+    //    / \   / \
+    //  (1)(3)(5) (7)
+    splay::Tree tree;
+    tree.assign({ 1, 2, 3, 4, 5, 6, 7 });
+
+    // -----------------
+    std::ostringstream dot;
+    splay::write_dot(dot, tree.get_root(), 2);
+    EXPECT_EQ(
+        "digraph splay {\n"
+        "    label=\"nodes 7, height 3, mean depth 1.42857, longest spine 2\";\n"
+        "    node [shape=circle];\n"
+        "    n0 [label=\"4\"];\n"
+        "    n0 -> n1;\n"
+        "    n0 -> n2;\n"
+        "    n1 [label=\"2\"];\n"
+        "    c0 [shape=box, label=\"+1\"];\n"
+        "    n1 -> c0;\n"
+        "    c1 [shape=box, label=\"+1\"];\n"
+        "    n1 -> c1;\n"
+        "    n2 [label=\"6\"];\n"
+        "    c2 [shape=box, label=\"+1\"];\n"
+        "    n2 -> c2;\n"
+        "    c3 [shape=box, label=\"+1\"];\n"
+        "    n2 -> c3;\n"
+        "}\n", dot.str());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, JsonLinksByIndex)
+{
+    // Initialization
+    //       (3)
+    //      /   \
+    //    (2)   (4)
+    //    /
+    //  (1)
+    splay::Tree tree;
+    tree.assign({ 1, 2, 3, 4 });
+
+    // -----------------
+    std::ostringstream json;
+    splay::write_json(json, tree.get_root(), 2);
+    EXPECT_EQ(
+        "{\"nodes\":["
+        "{\"key\":3,\"left\":1,\"right\":2},"
+        "{\"key\":2,\"left\":{\"cut\":1},\"right\":null},"
+        "{\"key\":4,\"left\":null,\"right\":null}"
+        "],\"summary\":{\"nodes\":4,\"height\":3,\"mean_depth\":1,\"longest_spine\":2,\"per_depth\":[1,2,1]}}\n",
+        json.str());
+
+    // keys that are not numbers are quoted and escaped
+    splay::BasicTree<std::string> words;
+    words.insert("say \"hi\"");
+    std::ostringstream quoted;
+    splay::write_json(quoted, words.get_root());
+    EXPECT_EQ(0u, quoted.str().find("{\"nodes\":[{\"key\":\"say \\\"hi\\\"\""));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, JsonEscapesControlCharacters)
+{
+    // Initialization
+    std::string key = "two\nlines\tand\x1f";
+    key += '\0';
+    key += "nul\r";
+    splay::BasicTree<std::string> words;
+    words.insert(key);
+
+    // -----------------
+    std::ostringstream json;
+    splay::write_json(json, words.get_root());
+    EXPECT_EQ(0u, json.str().find("{\"nodes\":[{\"key\":\"two\\nlines\\tand\\u001f\\u0000nul\\r\","));
+
+    // every character that is left is printable
+    for (const char c : json.str().substr(0, json.str().size() - 1))
+        EXPECT_LE(0x20, static_cast<unsigned char>(c));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, JsonCharAndBoolKeys)
+{
+    // characters are written as their codes, bool as true/false
+    splay::BasicTree<char> letters;
+    letters.insert('"');
+    std::ostringstream json;
+    splay::write_json(json, letters.get_root());
+    EXPECT_EQ(0u, json.str().find("{\"nodes\":[{\"key\":34,"));
+
+    splay::BasicTree<bool> flags;
+    flags.insert(true);
+    std::ostringstream flag_json;
+    splay::write_json(flag_json, flags.get_root());
+    EXPECT_EQ(0u, flag_json.str().find("{\"nodes\":[{\"key\":true,"));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, DotShowsControlCharacters)
+{
+    // Initialization
+    std::string key = "a\"b\\c\nd";
+    key += '\0';
+    splay::BasicTree<std::string> words;
+    words.insert(key);
+
+    // -----------------
+    // the label reads a"b\c\nd\x00: no line break, no JSON escape
+    std::ostringstream dot;
+    splay::write_dot(dot, words.get_root());
+    EXPECT_NE(std::string::npos, dot.str().find("    n0 [label=\"a\\\"b\\\\c\\\\nd\\\\x00\"];\n"));
+    EXPECT_EQ(std::string::npos, dot.str().find("\\u00"));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayExport, OtherNodeTypes)
+{
+    splay::WeightedTree tree;
+    for (int i = 0; i < 10; ++i)
+        tree.insert(i, static_cast<std::uint32_t>(i % 3));
+    EXPECT_EQ(10u, splay::depth_summary(tree.get_root()).nodes);
+    EXPECT_EQ(tree.height(), splay::depth_summary(tree.get_root()).height);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace splay
+{
+
+template <typename T>
+struct StaticNode
+{
+    T number {};
+    std::size_t left { 0 };
+    std::size_t right { 0 };
+}; // struct StaticNode
+
+
+// Read-only balanced search tree over a fixed key set, built entirely by
+// constexpr code, so a constexpr instance lives in static storage: no
+// startup inserts and no heap. Lookups never restructure the tree and
+// match the non-splaying contains()/find() of splay::BasicTree.
+//
+// Keys may be given in any order; duplicates are dropped. The build sorts
+// by insertion, which is fine for opcode-sized tables.
+template <typename T, std::size_t N, typename Compare = std::less<T>>
+class StaticTree
+{
+public:
+    using Node = StaticNode<T>;
+    using value_type = T;
+
+    // Index used as the null link.
+    static constexpr std::size_t npos = N;
+
+    constexpr explicit StaticTree(const T (&values)[N], const Compare& comp = Compare())
+        : comp(comp)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            std::size_t pos = count;
+            while (pos > 0 && comp(values[i], nodes[pos - 1].number))
+                --pos;
+            if (pos > 0 && !comp(nodes[pos - 1].number, values[i]))
+                continue;   // such value is already exist
+
+            for (std::size_t j = count; j > pos; --j)
+                nodes[j].number = nodes[j - 1].number;
+            nodes[pos].number = values[i];
+            ++count;
+        }
+        root = build(0, count);
+    }
+
+    constexpr const T* find(const T& number) const
+    {
+        return find_(number);
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    constexpr const T* find(const K& number) const
+    {
+        return find_(number);
+    }
+
+    constexpr bool contains(const T& number) const
+    {
+        return find_(number) != nullptr;
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    constexpr bool contains(const K& number) const
+    {
+        return find_(number) != nullptr;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return count;
+    }
+
+    constexpr int height() const
+    {
+        return height_(root);
+    }
+
+    // Index of the root node in get_nodes(), npos when empty.
+    constexpr std::size_t get_root() const
+    {
+        return root;
+    }
+
+    constexpr const Node* get_nodes() const
+    {
+        return nodes;
+    }
+
+private:
+    // One spare slot keeps the array non-empty for N == 0.
+    Node nodes[N + 1] {};
+    std::size_t count { 0 };
+    std::size_t root { npos };
+    Compare comp;
+
+    // Nodes are stored in key order; links the middle of [first, last).
+    constexpr std::size_t build(std::size_t first, std::size_t last)
+    {
+        if (first == last)
+            return npos;
+
+        const std::size_t mid = first + (last - first) / 2;
+        nodes[mid].left = build(first, mid);
+        nodes[mid].right = build(mid + 1, last);
+        return mid;
+    }
+
+    template <typename K>
+    constexpr const T* find_(const K& key) const
+    {
+        std::size_t node = root;
+        while (node != npos)
+        {
+            if (comp(key, nodes[node].number))
+                node = nodes[node].left;
+            else if (comp(nodes[node].number, key))
+                node = nodes[node].right;
+            else
+                return &nodes[node].number;
+        }
+        return nullptr;
+    }
+
+    constexpr int height_(std::size_t node) const
+    {
+        if (node == npos)
+            return 0;
+        const int left = height_(nodes[node].left);
+        const int right = height_(nodes[node].right);
+        return (left > right ? left : right) + 1;
+    }
+}; // class StaticTree
+
+
+template <typename T, std::size_t N>
+constexpr StaticTree<T, N> make_static_tree(const T (&values)[N])
+{
+    return StaticTree<T, N>(values);
+}
+
+template <typename T, std::size_t N, typename Compare>
+constexpr StaticTree<T, N, Compare> make_static_tree(const T (&values)[N], const Compare& comp)
+{
+    return StaticTree<T, N, Compare>(values, comp);
+}
+
+} // namespace splay
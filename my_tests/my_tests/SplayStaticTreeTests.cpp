@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "SplayStaticTree.h"
+
+#include <string_view>
+
+namespace
+{
+    using namespace std::literals;
+
+    constexpr auto opcodes = splay::make_static_tree<int>({ 0x90, 0x01, 0xc3, 0x31, 0x89, 0xe8, 0x01 });
+
+    constexpr auto fields = splay::make_static_tree<std::string_view>(
+        { "src_port"sv, "dst_port"sv, "length"sv, "checksum"sv }, std::less<>());
+
+    // Checks key order below `node`, which must hold inside [low, high).
+    constexpr bool IsOrdered(const splay::StaticNode<int>* nodes, std::size_t node, std::size_t npos, int low, int high)
+    {
+        if (node == npos)
+            return true;
+        return low <= nodes[node].number && nodes[node].number < high
+            && IsOrdered(nodes, nodes[node].left, npos, low, nodes[node].number)
+            && IsOrdered(nodes, nodes[node].right, npos, nodes[node].number + 1, high);
+    }
+
+    // --- Compile time structure ------------------------------------------
+    static_assert(opcodes.size() == 6, "duplicates are dropped");
+    static_assert(opcodes.height() == 3, "six keys fit three balanced levels");
+    static_assert(IsOrdered(opcodes.get_nodes(), opcodes.get_root(), opcodes.npos, 0, 0x100), "search tree order");
+    static_assert(opcodes.contains(0xc3) && opcodes.contains(0x01), "present keys");
+    static_assert(!opcodes.contains(0x00) && !opcodes.contains(0xff), "absent keys");
+    static_assert(*opcodes.find(0x89) == 0x89, "find returns the stored key");
+    static_assert(opcodes.find(0x88) == nullptr, "find misses");
+
+    static_assert(fields.size() == 4 && fields.height() == 3, "string view keys");
+    static_assert(fields.contains("length"sv) && !fields.contains("flags"sv), "transparent lookup");
+
+    constexpr int one_key[1] = { 7 };
+    static_assert(splay::make_static_tree(one_key).height() == 1, "single key");
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+TEST(SplayStaticTree, RuntimeLookup)
+{
+    for (const int key : { 0x90, 0x01, 0xc3, 0x31, 0x89, 0xe8 })
+    {
+        EXPECT_TRUE(opcodes.contains(key));
+        EXPECT_EQ(key, *opcodes.find(key));
+    }
+    for (int key = 0; key < 0x100; key += 3)
+    {
+        if (key != 0x90 && key != 0xc3 && key != 0x89)
+        {
+            EXPECT_FALSE(opcodes.contains(key));
+        }
+    }
+
+    const std::string_view wanted{ "dst_port" };
+    EXPECT_EQ(wanted, *fields.find(wanted));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayStaticTree, BalancedShape)
+{
+    int keys[100] = {};
+    for (int i = 0; i < 100; ++i)
+        keys[i] = (i * 37) % 100;
+    const auto tree = splay::make_static_tree(keys);
+    EXPECT_EQ(100u, tree.size());
+    EXPECT_EQ(7, tree.height());
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(tree.contains(i));
+    EXPECT_FALSE(tree.contains(100));
+}
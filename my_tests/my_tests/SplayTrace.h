@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace splay
+{
+
+enum class TraceOp : std::uint8_t
+{
+    Insert = 0,
+    Search = 1,
+    Erase = 2
+}; // enum class TraceOp
+
+struct TraceRecord
+{
+    TraceOp op;
+    int key;
+}; // struct TraceRecord
+
+namespace detail
+{
+
+constexpr char trace_magic[4] = { 'S', 'P', 'L', 'T' };
+constexpr unsigned char trace_version = 1;
+
+// read_trace() grows its batch buffer by at most this much per read, so a
+// corrupt batch length cannot allocate more than the stream really holds.
+constexpr std::size_t trace_read_chunk = 1 << 16;
+
+// Longest varint of a record: 35 significant bits.
+constexpr std::size_t max_record_bytes = 5;
+
+inline unsigned char* put_varint(unsigned char* out, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(value);
+    return out;
+}
+
+inline bool get_varint(const unsigned char*& in, const unsigned char* end, std::uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; in != end && shift < 64; shift += 7)
+    {
+        const unsigned char byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline std::uint64_t zigzag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+} // namespace detail
+
+
+// Records tree operations in a compact binary trace.
+//
+// Trace layout: the "SPLT" magic and a version byte, then batches. A batch
+// is its varint byte length followed by records, each one varint holding
+// (zigzag(key - previous key) << 2) | op. Deltas restart from 0 in every
+// batch, so batches decode on their own.
+//
+// With a sink, the header is written at once and every full batch after
+// it, so even a recorder that records nothing leaves a valid (empty)
+// trace. Without one the recorder
+// is a flight recorder: it keeps the last `ring_batches` batches in a ring
+// and dump() writes them out on demand, e.g. after a latency spike.
+class TraceRecorder
+{
+public:
+    static constexpr std::size_t default_batch_bytes = 1 << 16;
+
+    explicit TraceRecorder(std::ostream* sink = nullptr,
+        std::size_t batch_bytes = default_batch_bytes,
+        std::size_t ring_batches = 4)
+        : sink(sink)
+        , batch(std::max(batch_bytes, detail::max_record_bytes))
+        , ring_batches(std::max<std::size_t>(ring_batches, 1))
+    {
+        if (sink)
+            write_header(*sink);
+    }
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    ~TraceRecorder()
+    {
+        if (sink)
+            flush();
+    }
+
+    void record(TraceOp op, int key)
+    {
+        if (used + detail::max_record_bytes > batch.size())
+            seal();
+
+        const std::int64_t delta = static_cast<std::int64_t>(key) - previous;
+        previous = key;
+        unsigned char* end = detail::put_varint(batch.data() + used,
+            (detail::zigzag(delta) << 2) | static_cast<std::uint64_t>(op));
+        used = static_cast<std::size_t>(end - batch.data());
+        ++records;
+    }
+
+    // Writes the pending batch to the sink.
+    void flush()
+    {
+        seal();
+        if (sink)
+            sink->flush();
+    }
+
+    // Writes a complete trace of the retained batches and the pending one.
+    void dump(std::ostream& out) const
+    {
+        write_header(out);
+        for (const auto& sealed : ring)
+            write_batch(out, sealed.data(), sealed.size());
+        if (used)
+            write_batch(out, batch.data(), used);
+    }
+
+    std::uint64_t size() const
+    {
+        return records;
+    }
+
+private:
+    std::ostream* sink;
+    std::vector<unsigned char> batch;
+    std::size_t used = 0;
+    std::int64_t previous = 0;
+    std::uint64_t records = 0;
+    std::size_t ring_batches;
+    std::deque<std::vector<unsigned char>> ring;
+
+    void seal()
+    {
+        if (!used)
+            return;
+
+        if (sink)
+            write_batch(*sink, batch.data(), used);
+        else
+        {
+            if (ring.size() == ring_batches)
+                ring.pop_front();
+            ring.emplace_back(batch.begin(), batch.begin() + used);
+        }
+        used = 0;
+        previous = 0;
+    }
+
+    static void write_header(std::ostream& out)
+    {
+        out.write(detail::trace_magic, sizeof(detail::trace_magic));
+        out.put(static_cast<char>(detail::trace_version));
+    }
+
+    static void write_batch(std::ostream& out, const unsigned char* data, std::size_t size)
+    {
+        unsigned char length[10];
+        const unsigned char* length_end = detail::put_varint(length, size);
+        out.write(reinterpret_cast<const char*>(length), length_end - length);
+        out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+}; // class TraceRecorder
+
+
+// Decodes a whole trace. Returns false if the stream is not a valid trace;
+// the records decoded up to that point are kept.
+inline bool read_trace(std::istream& in, std::vector<TraceRecord>& records)
+{
+    char header[sizeof(detail::trace_magic) + 1];
+    if (!in.read(header, sizeof(header)))
+        return false;
+    if (!std::equal(detail::trace_magic, detail::trace_magic + sizeof(detail::trace_magic), header)
+        || static_cast<unsigned char>(header[sizeof(detail::trace_magic)]) != detail::trace_version)
+        return false;
+
+    std::vector<unsigned char> batch;
+    while (in.peek() != std::char_traits<char>::eof())
+    {
+        std::uint64_t size = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            const int byte = in.get();
+            if (byte == std::char_traits<char>::eof() || shift >= 64)
+                return false;
+            size |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+
+        batch.clear();
+        while (batch.size() < size)
+        {
+            const std::size_t read = batch.size();
+            const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size - read, detail::trace_read_chunk));
+            batch.resize(read + chunk);
+            if (!in.read(reinterpret_cast<char*>(batch.data() + read), static_cast<std::streamsize>(chunk)))
+                return false;
+        }
+
+        std::int64_t previous = 0;
+        const unsigned char* pos = batch.data();
+        const unsigned char* end = pos + batch.size();
+        while (pos != end)
+        {
+            std::uint64_t value = 0;
+            if (!detail::get_varint(pos, end, value) || (value & 3) > 2)
+                return false;
+            previous += detail::unzigzag(value >> 2);
+            records.push_back(TraceRecord{ static_cast<TraceOp>(value & 3), static_cast<int>(previous) });
+        }
+    }
+    return true;
+}
+
+
+// Opt-in tracing layer: forwards insert/search/erase to `tree` after
+// recording them.
+template <typename TreeT>
+class TracedTree
+{
+public:
+    TracedTree(TreeT& tree, TraceRecorder& recorder)
+        : tree(tree)
+        , recorder(recorder)
+    {
+    }
+
+    bool insert(int number)
+    {
+        recorder.record(TraceOp::Insert, number);
+        return tree.insert(number);
+    }
+
+    auto search(int number)
+    {
+        recorder.record(TraceOp::Search, number);
+        return tree.search(number);
+    }
+
+    bool erase(int number)
+    {
+        recorder.record(TraceOp::Erase, number);
+        return tree.erase(number);
+    }
+
+    TreeT& get_tree()
+    {
+        return tree;
+    }
+
+private:
+    TreeT& tree;
+    TraceRecorder& recorder;
+}; // class TracedTree
+
+} // namespace splay
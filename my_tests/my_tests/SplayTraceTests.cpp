@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include "SplayTree.h"
+#include "SplayTrace.h"
+
+#include <climits>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    void ExpectRecords(const std::vector<splay::TraceRecord>& expected, const std::vector<splay::TraceRecord>& actual)
+    {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            EXPECT_EQ(expected[i].op, actual[i].op);
+            EXPECT_EQ(expected[i].key, actual[i].key);
+        }
+    }
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, RoundTrip)
+{
+    const std::vector<splay::TraceRecord> expected{
+        { splay::TraceOp::Insert, 5 },
+        { splay::TraceOp::Insert, INT_MIN },
+        { splay::TraceOp::Search, INT_MAX },
+        { splay::TraceOp::Erase, -1 },
+        { splay::TraceOp::Search, 0 },
+    };
+
+    std::stringstream stream;
+    {
+        // tiny batches, so records span several of them
+        splay::TraceRecorder recorder(&stream, 8);
+        for (const auto& record : expected)
+            recorder.record(record.op, record.key);
+        EXPECT_EQ(expected.size(), recorder.size());
+    }
+
+    std::vector<splay::TraceRecord> actual;
+    EXPECT_TRUE(splay::read_trace(stream, actual));
+    ExpectRecords(expected, actual);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, CompactDeltas)
+{
+    std::stringstream stream;
+    splay::TraceRecorder recorder(&stream);
+    for (int i = 0; i < 1000; ++i)
+        recorder.record(splay::TraceOp::Search, 1000000 + i);
+    recorder.flush();
+
+    // one byte per record after the first one
+    EXPECT_GT(1100u, stream.str().size());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, Malformed)
+{
+    std::vector<splay::TraceRecord> records;
+    std::stringstream empty;
+    EXPECT_FALSE(splay::read_trace(empty, records));
+
+    std::stringstream wrong_magic("SPLX\x01");
+    EXPECT_FALSE(splay::read_trace(wrong_magic, records));
+
+    std::stringstream truncated(std::string("SPLT\x01\x05\x00", 7));
+    EXPECT_FALSE(splay::read_trace(truncated, records));
+
+    // a batch length of 2^40 with one byte behind it fails on the missing
+    // bytes instead of allocating a terabyte first
+    std::stringstream huge(std::string("SPLT\x01\x80\x80\x80\x80\x80\x20\x00", 12));
+    EXPECT_FALSE(splay::read_trace(huge, records));
+    EXPECT_TRUE(records.empty());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, NothingRecordedIsAnEmptyTrace)
+{
+    std::stringstream stream;
+    {
+        splay::TraceRecorder recorder(&stream);
+    }
+    EXPECT_EQ(std::string("SPLT\x01"), stream.str());
+
+    std::vector<splay::TraceRecord> records;
+    EXPECT_TRUE(splay::read_trace(stream, records));
+    EXPECT_TRUE(records.empty());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, FlightRecorderKeepsLastBatches)
+{
+    splay::TraceRecorder recorder(nullptr, 8, 2);
+    for (int i = 0; i < 100; ++i)
+        recorder.record(splay::TraceOp::Insert, i);
+
+    std::stringstream stream;
+    recorder.dump(stream);
+    std::vector<splay::TraceRecord> records;
+    EXPECT_TRUE(splay::read_trace(stream, records));
+    EXPECT_LT(0u, records.size());
+    EXPECT_GT(100u, records.size());
+    EXPECT_EQ(99, records.back().key);
+    for (std::size_t i = 1; i < records.size(); ++i)
+        EXPECT_EQ(records[i - 1].key + 1, records[i].key);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTrace, TracedTreeReplaysToSameTree)
+{
+    splay::Tree tree;
+    std::stringstream stream;
+    {
+        splay::TraceRecorder recorder(&stream);
+        splay::TracedTree<splay::Tree> traced(tree, recorder);
+        for (const auto n : { 21, 15, 12, 10, 20, 14, 26, 24, 17, 18, 27, 16 })
+            EXPECT_TRUE(traced.insert(n));
+        EXPECT_NE(nullptr, traced.search(20));
+        EXPECT_TRUE(traced.erase(14));
+        EXPECT_FALSE(traced.erase(14));
+    }
+
+    std::vector<splay::TraceRecord> records;
+    EXPECT_TRUE(splay::read_trace(stream, records));
+    EXPECT_EQ(15u, records.size());
+
+    splay::Tree replayed;
+    for (const auto& record : records)
+    {
+        if (record.op == splay::TraceOp::Insert)
+            replayed.insert(record.key);
+        else if (record.op == splay::TraceOp::Search)
+            replayed.search(record.key);
+        else
+            replayed.erase(record.key);
+    }
+    EXPECT_EQ(tree.get_root()->number, replayed.get_root()->number);
+    EXPECT_EQ(tree.height(), replayed.height());
+    EXPECT_EQ(tree.splay_depth(), replayed.splay_depth());
+}
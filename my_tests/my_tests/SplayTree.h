@@ -2,56 +2,1091 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 
 namespace splay
 {
 
-struct Node
-{
-    Node()
-        : number(0)
-        , left(nullptr)
-        , right(nullptr)
+namespace detail
+{
+
+inline void prefetch(const void* address)
+{
+#if defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+// 0 means one thread per hardware thread.
+inline unsigned thread_count(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    return std::max(threads, 1u);
+}
+
+// Number of binary fork levels needed to keep `threads` threads busy.
+inline int fork_depth(unsigned threads)
+{
+    int depth = 0;
+    while ((1u << depth) < threads)
+        ++depth;
+    return depth;
+}
+
+// Runs `left` on a new thread and `right` on the calling one when `fork`
+// is set, one after the other otherwise.
+template <typename Left, typename Right>
+void fork_join(bool fork, Left&& left, Right&& right)
+{
+    if (!fork)
+    {
+        left();
+        right();
+        return;
+    }
+
+    auto pending = std::async(std::launch::async, std::forward<Left>(left));
+    right();
+    pending.get();
+}
+
+} // namespace detail
+
+
+// Key prefix policy: nodes keep no cached comparison token.
+struct NoPrefix
+{
+}; // struct NoPrefix
+
+
+// Prefix policy for string-like keys: the first 8 bytes, big-endian and
+// zero padded, so that comparing two prefixes as integers agrees with a
+// bytewise lexicographic comparison of the keys whenever they differ.
+// Only valid with comparators ordering by unsigned bytes, like std::less.
+struct StringPrefix
+{
+    template <typename S>
+    std::uint64_t operator()(const S& key) const
+    {
+        const std::string_view view(key);
+        const std::size_t size = std::min<std::size_t>(view.size(), 8);
+        std::uint64_t prefix = 0;
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            prefix <<= 8;
+            if (i < size)
+                prefix |= static_cast<unsigned char>(view[i]);
+        }
+        return prefix;
+    }
+}; // struct StringPrefix
+
+
+// Storage of the cached token, empty for NoPrefix.
+template <typename Prefix>
+struct PrefixCache
+{
+    std::uint64_t prefix { 0 };
+}; // struct PrefixCache
+
+template <>
+struct PrefixCache<NoPrefix>
+{
+}; // struct PrefixCache<NoPrefix>
+
+
+template <typename T, typename Prefix = NoPrefix>
+struct BasicNode : PrefixCache<Prefix>
+{
+    BasicNode()
+        : number()
+        , left(nullptr)
+        , right(nullptr)
+    {
+    }
+
+    BasicNode(const T& n)
+        : number(n)
+        , left(nullptr)
+        , right(nullptr)
+    {
+    }
+
+    BasicNode(T&& n)
+        : number(std::move(n))
+        , left(nullptr)
+        , right(nullptr)
+    {
+    }
+
+    T number {};
+    BasicNode* left { nullptr };
+    BasicNode* right { nullptr };
+}; // struct BasicNode
+
+
+// Order in which compact() lays nodes out in memory.
+enum class NodeLayout
+{
+    InOrder,        // key order: in-order walks and range scans are sequential
+    VanEmdeBoas     // recursive blocks of subtrees: root-to-leaf paths touch few cache lines
+}; // enum class NodeLayout
+
+
+// Report of BasicTree::memory_usage().
+struct MemoryUsage
+{
+    std::size_t live_nodes = 0;
+    std::size_t heap_nodes = 0;         // allocated one by one
+    std::size_t slab_nodes = 0;         // living in slabs made by compact()
+    std::size_t slab_free_slots = 0;    // slab slots not holding a node
+    std::size_t live_bytes = 0;
+    std::size_t reserved_bytes = 0;     // heap nodes plus whole slabs, allocator overhead excluded
+    double fragmentation = 0;           // share of reserved bytes not holding live nodes
+    double scatter = 0;                 // share of in-order neighbours not adjacent in memory
+}; // struct MemoryUsage
+
+
+// Default key projection: the stored value is the key itself.
+struct Identity
+{
+    template <typename T>
+    const T& operator()(const T& value) const
+    {
+        return value;
+    }
+}; // struct Identity
+
+
+// Splay tree of unique values ordered by Compare applied to KeyOf(value).
+//
+// KeyOf projects the key out of a stored value (e.g. a member of a record),
+// so records are compared in place. When Compare declares is_transparent
+// (std::less<> does), lookups accept any type the comparator accepts and no
+// temporary key_type is built, just like std::set.
+//
+// Prefix, unless NoPrefix, maps keys to order-preserving 64-bit tokens
+// cached in every node (see StringPrefix). Descents then compare tokens
+// read from the node itself and touch the full key only on a tie, which
+// saves a dereference of e.g. a heap string buffer per level.
+template <typename T, typename Compare = std::less<T>, typename KeyOf = Identity, typename Prefix = NoPrefix>
+class BasicTree
+{
+public:
+    using Node = BasicNode<T, Prefix>;
+    using value_type = T;
+    using key_type = std::decay_t<decltype(std::declval<const KeyOf&>()(std::declval<const T&>()))>;
+    using key_compare = Compare;
+
+    // Owning handle of a node detached from a tree (see std::set::node_type).
+    // The node can be re-keyed through value() and linked into any tree
+    // without freeing or allocating it again.
+    class node_type
+    {
+    public:
+        node_type() = default;
+
+        node_type(node_type&& other) noexcept
+            : node(other.node)
+        {
+            other.node = nullptr;
+        }
+
+        node_type& operator=(node_type&& other) noexcept
+        {
+            if (this != &other)
+            {
+                delete node;
+                node = other.node;
+                other.node = nullptr;
+            }
+            return *this;
+        }
+
+        node_type(const node_type&) = delete;
+        node_type& operator=(const node_type&) = delete;
+
+        ~node_type()
+        {
+            delete node;
+        }
+
+        bool empty() const
+        {
+            return !node;
+        }
+
+        explicit operator bool() const
+        {
+            return node != nullptr;
+        }
+
+        T& value() const
+        {
+            return node->number;
+        }
+
+    private:
+        friend class BasicTree;
+
+        explicit node_type(Node* n)
+            : node(n)
+        {
+        }
+
+        Node* node { nullptr };
+    }; // class node_type
+
+    // Checked reference to a node linked in the tree. It carries the key
+    // and the node address, and is never dereferenced by itself: get(),
+    // erase(Handle) and update_key() first splay the key and use the node
+    // only if it is still the one found there, so a stale handle (its node
+    // erased, extracted, popped, cleared or moved by compaction) is detected
+    // and refused instead of touching freed or reused memory. A handle
+    // whose key was erased and reinserted at the same address refers to
+    // the new node of that key.
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        bool empty() const
+        {
+            return !node;
+        }
+
+        explicit operator bool() const
+        {
+            return node != nullptr;
+        }
+
+        const key_type& key() const
+        {
+            return *key_;
+        }
+
+        bool operator==(const Handle& other) const
+        {
+            return node == other.node;
+        }
+
+        bool operator!=(const Handle& other) const
+        {
+            return node != other.node;
+        }
+
+    private:
+        friend class BasicTree;
+
+        Handle(const key_type& key, Node* n)
+            : key_(key)
+            , node(n)
+        {
+        }
+
+        std::optional<key_type> key_;
+        Node* node { nullptr };
+    }; // class Handle
+
+    BasicTree() = default;
+
+    explicit BasicTree(const Compare& comp, const KeyOf& key_of = KeyOf())
+        : comp(comp)
+        , key_of(key_of)
+    {
+    }
+
+    BasicTree(BasicTree&& other) noexcept
+        : root(other.root)
+        , comp(std::move(other.comp))
+        , key_of(std::move(other.key_of))
+        , splay_depth_(other.splay_depth_)
+        , compact_links_(other.compact_links_)
+        , restructures_(other.restructures_ + 1)   // the compaction iterator may hold &other.root
+        , slabs(std::move(other.slabs))
+        , compaction(std::move(other.compaction))
+    {
+        other.root = nullptr;
+        other.slabs.clear();
+    }
+
+    BasicTree& operator=(BasicTree&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            root = other.root;
+            comp = std::move(other.comp);
+            key_of = std::move(other.key_of);
+            splay_depth_ = other.splay_depth_;
+            compact_links_ = other.compact_links_;
+            restructures_ = other.restructures_ + 1;
+            slabs = std::move(other.slabs);
+            compaction = std::move(other.compaction);
+            other.root = nullptr;
+            other.slabs.clear();
+        }
+        return *this;
+    }
+
+    BasicTree(const BasicTree&) = delete;
+    BasicTree& operator=(const BasicTree&) = delete;
+
+    ~BasicTree()
+    {
+        clear();
+    }
+
+    bool insert(const T& number)
+    {
+        return insert_(probe(key_of(number)), [this, &number]() { return new_node(number); });
+    }
+
+    bool insert(T&& number)
+    {
+        return insert_(probe(key_of(number)), [this, &number]() { return new_node(std::move(number)); });
+    }
+
+    // Links an extracted node into the tree. If its key is already present
+    // the handle keeps the node and false is returned.
+    bool insert(node_type&& handle)
+    {
+        if (handle.empty())
+            return false;
+
+        if (!insert_(probe(key_of(handle.node->number)), [&handle]() { return handle.node; }))
+            return false;
+
+        handle.node = nullptr;
+        return true;
+    }
+
+    // Splaying lookup. The node stays valid only until it is erased, and
+    // its `number` must not be written through it: that breaks the order
+    // and, with a Prefix policy, the cached prefix. Use find() to read a
+    // value and find_handle()/update_key() to change a key.
+    Node* search(const key_type& number)
+    {
+        return search_splay(probe(number));
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    Node* search(const K& number)
+    {
+        return search_splay(probe(number));
+    }
+
+    // Splaying lookup handing out a Handle, empty if there is no such key.
+    Handle find_handle(const key_type& number)
+    {
+        return handle(search_splay(probe(number)));
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    Handle find_handle(const K& number)
+    {
+        return handle(search_splay(probe(number)));
+    }
+
+    // Unlike search() these do not splay, so they are usable on a const tree.
+    const T* find(const key_type& number) const
+    {
+        const Node* node = search_(probe(number), root);
+        return node ? &node->number : nullptr;
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    const T* find(const K& number) const
+    {
+        const Node* node = search_(probe(number), root);
+        return node ? &node->number : nullptr;
+    }
+
+    bool contains(const key_type& number) const
+    {
+        return search_(probe(number), root) != nullptr;
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& number) const
+    {
+        return search_(probe(number), root) != nullptr;
+    }
+
+    // The node with the least key not less than `number`, or nullptr.
+    const Node* lower_bound(const key_type& number) const
+    {
+        return lower_bound_(probe(number));
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    const Node* lower_bound(const K& number) const
+    {
+        return lower_bound_(probe(number));
+    }
+
+    bool erase(const key_type& number)
+    {
+        return erase_(probe(number));
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool erase(const K& number)
+    {
+        return erase_(probe(number));
+    }
+
+    // The value the handle refers to, nullptr if the handle is stale.
+    // Splays the key.
+    const T* get(const Handle& handle)
+    {
+        Node* node = locate(handle);
+        return node ? &node->number : nullptr;
+    }
+
+    // False if the handle is stale.
+    bool erase(const Handle& handle)
+    {
+        Node* node = locate(handle);
+        return node && erase_(probe(key_of(node->number)));
+    }
+
+    // Replaces the value of the handle's node and moves the node to the
+    // place of its new key, keeping the node alive and the handle pointing
+    // at it: one splay to unlink it, one to relink it. Returns false, with
+    // nothing changed, if the handle is stale or the new key is held by
+    // another node.
+    bool update_key(Handle& handle, T number)
+    {
+        Node* node = locate(handle);
+        if (!node)
+            return false;
+
+        node = detach(probe(key_of(node->number)));
+        if (insert_(probe(key_of(number)), [node, &number]() { node->number = std::move(number); return node; }))
+        {
+            handle.key_.emplace(key_of(node->number));
+            return true;
+        }
+
+        insert_(probe(key_of(node->number)), [node]() { return node; });
+        return false;
+    }
+
+    // Remove the node with the least (greatest) key and hand it over, so
+    // the tree serves as a priority queue; unite() merges two of them.
+    // The node is splayed to the root first, hence amortized O(log n).
+    node_type pop_min()
+    {
+        if (!root)
+            return node_type();
+
+        Node* node = splay_min(root);
+        root = node->right;
+        node->right = nullptr;
+        return node_type(to_heap(node));
+    }
+
+    node_type pop_max()
+    {
+        if (!root)
+            return node_type();
+
+        Node* node = splay_max(root);
+        root = node->left;
+        node->left = nullptr;
+        return node_type(to_heap(node));
+    }
+
+    // Unlinks the node holding `number` and hands it over to the caller.
+    // The handle is empty if there is no such key.
+    node_type extract(const key_type& number)
+    {
+        return node_type(to_heap(detach(probe(number))));
+    }
+
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    node_type extract(const K& number)
+    {
+        return node_type(to_heap(detach(probe(number))));
+    }
+
+    // Batched non-splaying lookup: results[i] is the node holding keys[i]
+    // or nullptr. Up to `group` descents are advanced round-robin, one
+    // level at a time, and each prefetches its next node, so the cache
+    // misses of independent descents overlap instead of queueing up.
+    void find_batch(const key_type* keys, std::size_t count, const Node** results, std::size_t group = 16) const
+    {
+        find_batch_(keys, count, results, nullptr, group);
+    }
+
+    // As find_batch(), then splays the hits found deeper than `splay_below`
+    // levels, so frequently searched keys still move towards the root.
+    void search_batch(const key_type* keys, std::size_t count, Node** results, int splay_below = 8, std::size_t group = 16)
+    {
+        std::vector<int> depths(count);
+        find_batch_(keys, count, const_cast<const Node**>(results), depths.data(), group);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (results[i] && depths[i] > splay_below)
+                root = splay(probe(keys[i]), root);
+        }
+    }
+
+    void clear()
+    {
+        finish_compaction();
+
+        // Rotate left children up until the root has none, then drop it:
+        // no recursion, so degenerate spines cannot overflow the stack.
+        while (root)
+        {
+            if (root->left)
+                root = RR_rotate(root);
+            else
+            {
+                Node* next = root->right;
+                free_node(root);
+                root = next;
+            }
+        }
+    }
+
+    // Set algebra with the nodes of `other`, which is left empty. Nodes are
+    // moved, never copied, and the ones dropped from the result are freed.
+    // Both trees are flattened in key order, combined in up to `threads`
+    // independent key ranges and relinked perfectly balanced. Every O(n)
+    // phase is split over the threads, but the speedup has only been
+    // checked for correctness, not measured on a multi-core machine.
+    void unite(BasicTree&& other, unsigned threads = 1)
+    {
+        combine(std::move(other), SetOp::Union, threads);
+    }
+
+    void intersect(BasicTree&& other, unsigned threads = 1)
+    {
+        combine(std::move(other), SetOp::Intersection, threads);
+    }
+
+    void subtract(BasicTree&& other, unsigned threads = 1)
+    {
+        combine(std::move(other), SetOp::Difference, threads);
+    }
+
+    // Replaces the content by `values`, given in any order, and builds a
+    // perfectly balanced tree. Of equivalent values the first is kept.
+    void assign(std::vector<T> values, unsigned threads = 1)
+    {
+        clear();
+        threads = detail::thread_count(threads);
+
+        const auto value_less = [this](const T& a, const T& b) { return comp(key_of(a), key_of(b)); };
+        sort_parallel(values, value_less, threads);
+        values.erase(std::unique(values.begin(), values.end(),
+            [&value_less](const T& a, const T& b) { return !value_less(a, b); }), values.end());
+
+        std::vector<Node*> nodes(values.size());
+        for_ranges(nodes.size(), threads, parallel_grain, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                // the value is moved into the node before its key is probed
+                Node* node = new Node(std::move(values[i]));
+                nodes[i] = link_node(probe(key_of(node->number)), node);
+            }
+        });
+
+        root = build_balanced(nodes.data(), nodes.data() + nodes.size(), detail::fork_depth(threads));
+    }
+
+    int height() const
+    {
+        return height_(root);
+    }
+
+    // Total number of levels descended by all splays so far, the cost
+    // measure of the amortized analysis.
+    std::uint64_t splay_depth() const
+    {
+        return splay_depth_;
+    }
+
+    // Total number of links compaction has followed to find the nodes to
+    // relocate: about one per node, plus a descent per step that follows
+    // a change of the tree.
+    std::uint64_t compact_links() const
+    {
+        return compact_links_;
+    }
+
+    // For walking the tree; the same rules as for search() apply.
+    Node* get_root()
+    {
+        return root;
+    }
+
+    // Walks the whole tree, without splaying, and reports where its nodes
+    // live and how scattered they are.
+    MemoryUsage memory_usage() const
+    {
+        MemoryUsage usage;
+        std::size_t scattered = 0;
+        const Node* previous = nullptr;
+        std::vector<const Node*> stack;
+        const Node* node = root;
+        while (node || !stack.empty())
+        {
+            while (node)
+            {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+
+            ++usage.live_nodes;
+            if (find_slab(node))
+                ++usage.slab_nodes;
+            else
+                ++usage.heap_nodes;
+            if (previous && reinterpret_cast<std::uintptr_t>(node) - reinterpret_cast<std::uintptr_t>(previous) != sizeof(Node))
+                ++scattered;
+            previous = node;
+            node = node->right;
+        }
+
+        std::size_t slab_slots = 0;
+        for (const auto& slab : slabs)
+            slab_slots += slab.capacity;
+        usage.slab_free_slots = slab_slots - usage.slab_nodes;
+        usage.live_bytes = usage.live_nodes * sizeof(Node);
+        usage.reserved_bytes = (usage.heap_nodes + slab_slots) * sizeof(Node);
+        if (usage.reserved_bytes)
+            usage.fragmentation = 1.0 - static_cast<double>(usage.live_bytes) / usage.reserved_bytes;
+        if (usage.live_nodes > 1)
+            usage.scatter = static_cast<double>(scattered) / (usage.live_nodes - 1);
+        return usage;
+    }
+
+    // Relocates every node into one fresh contiguous slab in `layout` order,
+    // optionally relinking the tree perfectly balanced first (always done
+    // for VanEmdeBoas, which is defined on the balanced shape). Slabs left
+    // empty are returned to the system.
+    void compact(NodeLayout layout = NodeLayout::InOrder, bool rebalance = false)
+    {
+        compact_begin(layout, rebalance);
+        while (!compact_step(SIZE_MAX))
+            ;
+    }
+
+    // Incremental form of compact(): compact_begin() does the O(n) setup
+    // (and the rebalance), then each compact_step() relocates at most
+    // `budget` nodes and returns true once compaction is over. The tree can
+    // be used and modified freely between steps; nodes are visited by key,
+    // so keys inserted behind the cursor simply stay where they are.
+    // A step walks an in-order iterator, O(budget) amortized, plus one
+    // O(height) descent to rebuild it if the tree was splayed or changed
+    // since the previous step; pass rebalance to bound that height too.
+    void compact_begin(NodeLayout layout = NodeLayout::InOrder, bool rebalance = false)
+    {
+        finish_compaction();
+
+        std::vector<Node*> nodes;
+        flatten(root, nodes);
+        if (nodes.empty())
+            return;
+
+        if (rebalance || layout == NodeLayout::VanEmdeBoas)
+            root = build_balanced(nodes.data(), nodes.data() + nodes.size(), 0);
+
+        compaction.reset(new Compaction());
+        compaction->target = std::allocator<Node>().allocate(nodes.size());
+        compaction->capacity = nodes.size();
+        if (layout == NodeLayout::VanEmdeBoas)
+            compaction->slot_of_rank = veb_slots(nodes.size());
+        slabs.push_back(Slab{ compaction->target, nodes.size(), 0, nullptr });
+        seek(*compaction);
+    }
+
+    bool compact_step(std::size_t budget)
+    {
+        if (!compaction)
+            return true;
+
+        Compaction& state = *compaction;
+        if (state.restructures != restructures_)
+            seek(state);
+
+        for (; budget > 0 && state.rank < state.capacity; --budget)
+        {
+            if (state.stack.empty())
+                break;
+
+            Node** link = state.stack.back();
+            state.stack.pop_back();
+            Node* node = *link;
+            const std::size_t slot = state.slot_of_rank.empty() ? state.rank : state.slot_of_rank[state.rank];
+            ++state.rank;
+
+            Node* moved = ::new (static_cast<void*>(state.target + slot)) Node(std::move(node->number));
+            moved->left = node->left;
+            moved->right = node->right;
+            copy_prefix(moved, node);
+            ++find_slab(moved)->live;
+            *link = moved;
+            state.cursor.emplace(key_of(moved->number));
+            free_node(node);
+            push_left_links(state, &moved->right);
+        }
+
+        if (budget > 0 || state.rank == state.capacity)
+        {
+            finish_compaction();
+            return true;
+        }
+        return false;
+    }
+
+private:
+    // Contiguous storage for nodes relocated by compact(). A free slot
+    // holds the pointer to the next free slot of its slab.
+    struct Slab
+    {
+        Node* slots;
+        std::size_t capacity;
+        std::size_t live;
+        Node* free_list;
+    }; // struct Slab
+
+    // Progress of an incremental compaction.
+    struct Compaction
+    {
+        Node* target { nullptr };
+        std::size_t capacity { 0 };
+        std::size_t rank { 0 };
+        std::vector<std::size_t> slot_of_rank;  // empty for in-order
+        std::optional<key_type> cursor;         // last key relocated
+
+        // In-order iterator over links: the links of the nodes still to
+        // relocate whose left subtrees are done, next one on top. Valid
+        // while `restructures` matches the tree's, rebuilt from `cursor`
+        // in O(height) otherwise.
+        std::vector<Node**> stack;
+        std::uint64_t restructures { 0 };
+    }; // struct Compaction
+
+    // State of a top-down splay between the descent and the reassembly.
+    // Only links, as in BlockTree::splay(), so no T is constructed:
+    // `header_right` holds the left tree and `header_left` the right one,
+    // LeftTreeMax/RightTreeMin are the empty links where they grow next.
+    struct Split
+    {
+        Split() = default;
+        Split(const Split&) = delete;
+        Split& operator=(const Split&) = delete;
+
+        Node* header_left { nullptr };
+        Node* header_right { nullptr };
+        Node** LeftTreeMax { &header_right };
+        Node** LeftTreeMaxLink { nullptr };     // link holding the left tree maximum
+        Node** RightTreeMin { &header_left };
+    }; // struct Split
+
+    // A looked up key together with its token, computed once per operation.
+    template <typename K>
+    struct Probe
+    {
+        const K& key;
+        std::uint64_t prefix;
+    }; // struct Probe
+
+    static constexpr bool cache_prefix = !std::is_same<Prefix, NoPrefix>::value;
+
+    Node* root = {nullptr};
+    Compare comp;
+    KeyOf key_of;
+    Prefix prefix_of;
+    std::uint64_t splay_depth_ = 0;
+    std::uint64_t compact_links_ = 0;
+    std::uint64_t restructures_ = 0;   // bumped by every change of links
+    std::vector<Slab> slabs;
+    std::unique_ptr<Compaction> compaction;
+
+    Slab* find_slab(const Node* node)
+    {
+        return const_cast<Slab*>(static_cast<const BasicTree*>(this)->find_slab(node));
+    }
+
+    const Slab* find_slab(const Node* node) const
+    {
+        const std::less<const Node*> before;
+        for (const auto& slab : slabs)
+        {
+            if (!before(node, slab.slots) && before(node, slab.slots + slab.capacity))
+                return &slab;
+        }
+        return nullptr;
+    }
+
+    // Takes a free slab slot when there is one, so churn after a compaction
+    // refills the slabs before growing the heap.
+    template <typename V>
+    Node* new_node(V&& value)
+    {
+        for (auto& slab : slabs)
+        {
+            if (!slab.free_list)
+                continue;
+
+            Node* slot = slab.free_list;
+            Node* next = *std::launder(reinterpret_cast<Node**>(slot));
+            Node* node = ::new (static_cast<void*>(slot)) Node(std::forward<V>(value));
+            slab.free_list = next;
+            ++slab.live;
+            return node;
+        }
+        return new Node(std::forward<V>(value));
+    }
+
+    void free_node(Node* node)
+    {
+        Slab* slab = find_slab(node);
+        if (!slab)
+        {
+            delete node;
+            return;
+        }
+
+        node->~Node();
+        ::new (static_cast<void*>(node)) Node*(slab->free_list);
+        slab->free_list = node;
+        if (--slab->live == 0 && !(compaction && compaction->target == slab->slots))
+            release_slab(slab);
+    }
+
+    void release_slab(Slab* slab)
+    {
+        std::allocator<Node>().deallocate(slab->slots, slab->capacity);
+        slabs.erase(slabs.begin() + (slab - slabs.data()));
+    }
+
+    // Node handles own heap nodes only, so a node leaving a slab is moved
+    // into a node of its own.
+    Node* to_heap(Node* node)
+    {
+        if (!node || !find_slab(node))
+            return node;
+
+        Node* heap = new Node(std::move(node->number));
+        copy_prefix(heap, node);
+        free_node(node);
+        return heap;
+    }
+
+    static void copy_prefix(Node* to, const Node* from)
+    {
+        if constexpr (cache_prefix)
+            to->prefix = from->prefix;
+    }
+
+    Handle handle(Node* node) const
+    {
+        return node ? Handle(key_of(node->number), node) : Handle();
+    }
+
+    // The handle's node splayed to the root, or nullptr if the handle is
+    // stale. The node address is only compared, never dereferenced.
+    Node* locate(const Handle& handle)
+    {
+        if (handle.empty())
+            return nullptr;
+
+        Node* node = search_splay(probe(*handle.key_));
+        return (node == handle.node) ? node : nullptr;
+    }
+
+    // Ends a compaction where it stands: slots it did not fill become free.
+    void finish_compaction()
     {
+        if (!compaction)
+            return;
+
+        std::unique_ptr<Compaction> state = std::move(compaction);
+        Slab* slab = find_slab(state->target);
+        std::vector<bool> used(state->capacity, false);
+        for (std::size_t rank = 0; rank < state->rank; ++rank)
+            used[state->slot_of_rank.empty() ? rank : state->slot_of_rank[rank]] = true;
+        for (std::size_t slot = state->capacity; slot-- > 0;)
+        {
+            if (used[slot])
+                continue;
+            ::new (static_cast<void*>(slab->slots + slot)) Node*(slab->free_list);
+            slab->free_list = slab->slots + slot;
+        }
+        if (slab->live == 0)
+            release_slab(slab);
     }
 
-    Node(int n)
-        : number(n)
-        , left(nullptr)
-        , right(nullptr)
+    // Points the iterator of `state` at the least key greater than its
+    // cursor (the least key when there is no cursor yet).
+    void seek(Compaction& state)
+    {
+        state.stack.clear();
+        Node** link = &root;
+        for (; *link; ++compact_links_)
+        {
+            Node* node = *link;
+            if (!state.cursor || less(probe(*state.cursor), node))
+            {
+                state.stack.push_back(link);
+                link = &node->left;
+            }
+            else
+                link = &node->right;
+        }
+        state.restructures = restructures_;
+    }
+
+    void push_left_links(Compaction& state, Node** link)
+    {
+        for (; *link; link = &(*link)->left, ++compact_links_)
+            state.stack.push_back(link);
+    }
+
+    // Height of the tree build_balanced() makes of n nodes.
+    static int balanced_height(std::size_t n)
     {
+        int height = 0;
+        for (; n; n /= 2)
+            ++height;
+        return height;
     }
 
-    int number { 0 };
-    Node* left { nullptr };
-    Node* right { nullptr };
-}; // struct Node
+    // Slot of each in-order rank when the tree build_balanced() makes of n
+    // nodes is stored in van Emde Boas order: the top half of the levels
+    // first, then every subtree hanging below it, each laid out the same way.
+    static std::vector<std::size_t> veb_slots(std::size_t n)
+    {
+        std::vector<std::size_t> slots(n);
+        std::size_t next = 0;
+        veb_layout(0, n, balanced_height(n), slots, next);
+        return slots;
+    }
 
+    static void veb_layout(std::size_t first, std::size_t last, int levels, std::vector<std::size_t>& slots, std::size_t& next)
+    {
+        if (first == last || levels == 0)
+            return;
 
-class Tree
-{
-public:
-    bool insert(int number)
+        if (levels == 1)
+        {
+            slots[first + (last - first) / 2] = next++;
+            return;
+        }
+
+        const int top = levels / 2;
+        veb_layout(first, last, top, slots, next);
+        veb_bottoms(first, last, top, levels - top, slots, next);
+    }
+
+    // Lays out the subtrees `depth` levels below [first, last).
+    static void veb_bottoms(std::size_t first, std::size_t last, int depth, int levels, std::vector<std::size_t>& slots, std::size_t& next)
+    {
+        if (first == last)
+            return;
+
+        if (depth == 0)
+        {
+            veb_layout(first, last, levels, slots, next);
+            return;
+        }
+
+        const std::size_t mid = first + (last - first) / 2;
+        veb_bottoms(first, mid, depth - 1, levels, slots, next);
+        veb_bottoms(mid + 1, last, depth - 1, levels, slots, next);
+    }
+
+    template <typename K>
+    Probe<K> probe(const K& key) const
+    {
+        if constexpr (cache_prefix)
+            return Probe<K>{ key, prefix_of(key) };
+        else
+            return Probe<K>{ key, 0 };
+    }
+
+    template <typename K>
+    bool less(const Probe<K>& key, const Node* node) const
+    {
+        if constexpr (cache_prefix)
+        {
+            if (key.prefix != node->prefix)
+                return key.prefix < node->prefix;
+        }
+        return comp(key.key, key_of(node->number));
+    }
+
+    template <typename K>
+    bool greater(const Probe<K>& key, const Node* node) const
+    {
+        if constexpr (cache_prefix)
+        {
+            if (key.prefix != node->prefix)
+                return key.prefix > node->prefix;
+        }
+        return comp(key_of(node->number), key.key);
+    }
+
+    template <typename K>
+    bool equal(const Probe<K>& key, const Node* node) const
+    {
+        return !less(key, node) && !greater(key, node);
+    }
+
+    // Splays `key` to the root; false if it is already there. Otherwise the
+    // node returned by `make_node` becomes the new root. The node is only
+    // made once the key is known to be new.
+    template <typename MakeNode>
+    bool insert_(const Probe<key_type>& key, MakeNode make_node)
     {
         if (!root)
         {
-            root = new Node(number);;
+            ++restructures_;
+            root = link_node(key, make_node());
             return true;
         }
 
-        root = splay(number, root);
+        root = splay(key, root);
 
-        if (number < root->number)
+        if (less(key, root))
         {
-            splay::Node* new_node = new Node(number);
+            Node* new_node = link_node(key, make_node());
             new_node->left = root->left;
             new_node->right = root;
             root->left = nullptr;
             root = new_node;
         }
-        else if (number > root->number)
+        else if (greater(key, root))
         {
-            splay::Node* new_node = new Node(number);
+            Node* new_node = link_node(key, make_node());
             new_node->right = root->right;
             new_node->left = root;
             root->right = nullptr;
@@ -66,66 +1101,520 @@ public:
         return true;
     }
 
-    Node* search(int number)
+    enum class SetOp
     {
-        if (!root)
+        Union,
+        Intersection,
+        Difference
+    }; // enum class SetOp
+
+    // Ranges below this size are not worth a thread of their own.
+    static constexpr std::size_t parallel_grain = 1 << 14;
+
+    // Calls visit(node) on the nodes of the subtree in key order,
+    // iteratively.
+    template <typename Visit>
+    static void in_order(Node* node, Visit visit)
+    {
+        std::vector<Node*> stack;
+        while (node || !stack.empty())
+        {
+            while (node)
+            {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            visit(node);
+            node = node->right;
+        }
+    }
+
+    // Appends the nodes of the subtree in key order.
+    static void flatten(Node* node, std::vector<Node*>& out)
+    {
+        in_order(node, [&out](Node* next) { out.push_back(next); });
+    }
+
+    // One item of the top levels in key order: a whole subtree, or a node
+    // without its children.
+    struct Piece
+    {
+        Node* node;
+        bool whole;
+    }; // struct Piece
+
+    static void cut_pieces(Node* node, int depth, std::vector<Piece>& pieces)
+    {
+        if (!node)
+            return;
+        if (depth == 0)
+        {
+            pieces.push_back(Piece{ node, true });
+            return;
+        }
+        cut_pieces(node->left, depth - 1, pieces);
+        pieces.push_back(Piece{ node, false });
+        cut_pieces(node->right, depth - 1, pieces);
+    }
+
+    // flatten() on up to `threads` threads. The top levels are cut into
+    // subtrees, which are sized concurrently and then flattened
+    // concurrently, each straight into its place in the result. A splay
+    // tree can be lopsided, so it is cut into a few pieces per thread.
+    static std::vector<Node*> flatten_parallel(Node* node, unsigned threads)
+    {
+        std::vector<Node*> nodes;
+        if (threads <= 1)
+        {
+            flatten(node, nodes);
+            return nodes;
+        }
+
+        std::vector<Piece> pieces;
+        cut_pieces(node, detail::fork_depth(threads) + 2, pieces);
+
+        std::vector<std::size_t> offsets(pieces.size() + 1, 0);
+        for_ranges(pieces.size(), threads, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                std::size_t size = 1;
+                if (pieces[i].whole)
+                {
+                    size = 0;
+                    in_order(pieces[i].node, [&size](Node*) { ++size; });
+                }
+                offsets[i + 1] = size;
+            }
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        nodes.resize(offsets.back());
+        for_ranges(pieces.size(), threads, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                Node** out = nodes.data() + offsets[i];
+                if (pieces[i].whole)
+                    in_order(pieces[i].node, [&out](Node* next) { *out++ = next; });
+                else
+                    *out = pieces[i].node;
+            }
+        });
+        return nodes;
+    }
+
+    // Relinks sorted nodes into a perfectly balanced tree, building the
+    // two halves on separate threads for the top `fork_depth` levels.
+    static Node* build_balanced(Node** first, Node** last, int fork_depth)
+    {
+        if (first == last)
             return nullptr;
 
-        root = splay(number, root);
+        Node** mid = first + (last - first) / 2;
+        Node* node = *mid;
+        detail::fork_join(fork_depth > 0 && static_cast<std::size_t>(last - first) > parallel_grain,
+            [&]() { node->left = build_balanced(first, mid, fork_depth - 1); },
+            [&]() { node->right = build_balanced(mid + 1, last, fork_depth - 1); });
+        return node;
+    }
 
-        return (root->number == number) ? root : nullptr;
+    // Calls body(first, last) on up to `threads` consecutive chunks of
+    // [0, size), of at least `grain` items each, concurrently.
+    template <typename Body>
+    static void for_ranges(std::size_t size, std::size_t threads, std::size_t grain, Body body)
+    {
+        const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, size / grain));
+        std::vector<std::future<void>> pending;
+        for (std::size_t i = 1; i < chunks; ++i)
+            pending.push_back(std::async(std::launch::async, body, i * size / chunks, (i + 1) * size / chunks));
+        body(0, size / chunks);
+        for (auto& chunk : pending)
+            chunk.get();
     }
 
-    bool erase(int number)
+    // Stable sort of chunks on separate threads followed by rounds of
+    // pairwise merges, also in parallel.
+    template <typename Less>
+    static void sort_parallel(std::vector<T>& values, Less value_less, unsigned threads)
     {
-        if (!root)
-            return false;
+        const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, values.size() / parallel_grain));
+        std::vector<std::size_t> bounds;
+        for (std::size_t i = 0; i <= chunks; ++i)
+            bounds.push_back(i * values.size() / chunks);
 
-        Node* temp;
-        root = splay(number, root);
-        if (number != root->number)
-            return false;
-        else
+        for_ranges(chunks, chunks, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+                std::stable_sort(values.begin() + bounds[i], values.begin() + bounds[i + 1], value_less);
+        });
+
+        for (std::size_t width = 1; width < chunks; width *= 2)
+        {
+            std::vector<std::future<void>> pending;
+            for (std::size_t i = 0; i + width < chunks; i += 2 * width)
+            {
+                const auto first = values.begin() + bounds[i];
+                const auto middle = values.begin() + bounds[i + width];
+                const auto last = values.begin() + bounds[std::min(i + 2 * width, chunks)];
+                pending.push_back(std::async(std::launch::async, [=]() { std::inplace_merge(first, middle, last, value_less); }));
+            }
+            for (auto& merge : pending)
+                merge.get();
+        }
+    }
+
+    // Merges two sorted node ranges into `out` according to `op`; the nodes
+    // that do not make it into the result go to `dropped`.
+    void combine_range(SetOp op, Node** a, Node** a_last, Node** b, Node** b_last, std::vector<Node*>& out, std::vector<Node*>& dropped) const
+    {
+        while (a != a_last && b != b_last)
         {
-            if (!root->left)
+            if (comp(key_of((*a)->number), key_of((*b)->number)))
             {
-                temp = root;
-                root = root->right;
+                if (op == SetOp::Intersection)
+                    dropped.push_back(*a);
+                else
+                    out.push_back(*a);
+                ++a;
+            }
+            else if (comp(key_of((*b)->number), key_of((*a)->number)))
+            {
+                if (op == SetOp::Union)
+                    out.push_back(*b);
+                else
+                    dropped.push_back(*b);
+                ++b;
             }
             else
             {
-                temp = root;
-                root = splay(number, root->left);
-                root->right = temp->right;
+                if (op == SetOp::Difference)
+                    dropped.push_back(*a);
+                else
+                    out.push_back(*a);
+                dropped.push_back(*b);
+                ++a;
+                ++b;
             }
-            delete temp;
-            return true;
+        }
+        for (; a != a_last; ++a)
+        {
+            if (op == SetOp::Intersection)
+                dropped.push_back(*a);
+            else
+                out.push_back(*a);
+        }
+        for (; b != b_last; ++b)
+        {
+            if (op == SetOp::Union)
+                out.push_back(*b);
+            else
+                dropped.push_back(*b);
         }
     }
 
-    int height() const
+    // free_node() of every node in `parts`, one part per thread. Values are
+    // destroyed and heap nodes deleted on the threads; slab slots are only
+    // chained per part and slab there, because the free lists are shared,
+    // and the chains are spliced in afterwards in O(parts * slabs).
+    void free_parts(std::vector<std::vector<Node*>>& parts)
     {
-        return height_(root);
+        struct Chain
+        {
+            Node* head { nullptr };
+            Node* tail { nullptr };
+            std::size_t count { 0 };
+        }; // struct Chain
+
+        std::vector<std::vector<Chain>> chains(parts.size(), std::vector<Chain>(slabs.size()));
+        for_ranges(parts.size(), parts.size(), 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                for (Node* node : parts[i])
+                {
+                    const Slab* slab = static_cast<const BasicTree*>(this)->find_slab(node);
+                    if (!slab)
+                    {
+                        delete node;
+                        continue;
+                    }
+
+                    Chain& chain = chains[i][slab - slabs.data()];
+                    node->~Node();
+                    ::new (static_cast<void*>(node)) Node*(chain.head);
+                    if (!chain.tail)
+                        chain.tail = node;
+                    chain.head = node;
+                    ++chain.count;
+                }
+            }
+        });
+
+        for (const auto& part : chains)
+        {
+            for (std::size_t i = 0; i < slabs.size(); ++i)
+            {
+                if (!part[i].count)
+                    continue;
+                *std::launder(reinterpret_cast<Node**>(part[i].tail)) = slabs[i].free_list;
+                slabs[i].free_list = part[i].head;
+                slabs[i].live -= part[i].count;
+            }
+        }
+        for (std::size_t i = slabs.size(); i-- > 0;)
+        {
+            if (slabs[i].live == 0 && !(compaction && compaction->target == slabs[i].slots))
+                release_slab(&slabs[i]);
+        }
     }
 
-    Node* get_root()
+    void combine(BasicTree&& other, SetOp op, unsigned threads)
     {
-        return root;
+        if (this == &other)
+            return;
+
+        threads = detail::thread_count(threads);
+
+        std::vector<Node*> a = flatten_parallel(root, threads);
+        std::vector<Node*> b = flatten_parallel(other.root, threads);
+        root = nullptr;
+        other.root = nullptr;
+
+        // the nodes of `other` bring their slabs along
+        finish_compaction();
+        other.finish_compaction();
+        slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+        other.slabs.clear();
+
+        // Split both sequences at keys picked evenly from the longer one;
+        // equal keys always fall into the same part.
+        const std::vector<Node*>& pivots = (a.size() >= b.size()) ? a : b;
+        const std::size_t parts = std::max<std::size_t>(1, std::min<std::size_t>(threads, pivots.size() / parallel_grain));
+        std::vector<std::size_t> a_bounds{ 0 };
+        std::vector<std::size_t> b_bounds{ 0 };
+        for (std::size_t i = 1; i < parts; ++i)
+        {
+            const key_type& pivot = key_of(pivots[i * pivots.size() / parts]->number);
+            const auto node_less = [this](const Node* node, const key_type& key) { return comp(key_of(node->number), key); };
+            a_bounds.push_back(std::lower_bound(a.begin(), a.end(), pivot, node_less) - a.begin());
+            b_bounds.push_back(std::lower_bound(b.begin(), b.end(), pivot, node_less) - b.begin());
+        }
+        a_bounds.push_back(a.size());
+        b_bounds.push_back(b.size());
+
+        std::vector<std::vector<Node*>> results(parts);
+        std::vector<std::vector<Node*>> dropped(parts);
+        for_ranges(parts, parts, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t i = first; i < last; ++i)
+            {
+                combine_range(op, a.data() + a_bounds[i], a.data() + a_bounds[i + 1],
+                    b.data() + b_bounds[i], b.data() + b_bounds[i + 1], results[i], dropped[i]);
+            }
+        });
+
+        free_parts(dropped);
+
+        // every part is copied to its offset in the result concurrently
+        std::vector<Node*> nodes;
+        if (parts == 1)
+            nodes = std::move(results[0]);
+        else
+        {
+            std::vector<std::size_t> offsets{ 0 };
+            for (const auto& part : results)
+                offsets.push_back(offsets.back() + part.size());
+            nodes.resize(offsets.back());
+            for_ranges(parts, parts, 1, [&](std::size_t first, std::size_t last)
+            {
+                for (std::size_t i = first; i < last; ++i)
+                    std::copy(results[i].begin(), results[i].end(), nodes.begin() + offsets[i]);
+            });
+        }
+
+        root = build_balanced(nodes.data(), nodes.data() + nodes.size(), detail::fork_depth(threads));
     }
 
-private:
-    Node* root = {nullptr};
+    Node* link_node(const Probe<key_type>& key, Node* node) const
+    {
+        if constexpr (cache_prefix)
+            node->prefix = key.prefix;
+        return node;
+    }
 
-    Node* search_(int key, Node* node)
+    template <typename K>
+    Node* search_splay(const Probe<K>& number)
     {
-        if (!node)
+        if (!root)
             return nullptr;
-        if (key == node->number)
-            return node;
-        else if (key < node->number)
-            return search_(key, node->left);
+
+        root = splay(number, root);
+
+        return equal(number, root) ? root : nullptr;
+    }
+
+    template <typename K>
+    bool erase_(const Probe<K>& number)
+    {
+        Node* node = detach(number);
+        if (node)
+            free_node(node);
+        return node != nullptr;
+    }
+
+    // Unlinks the node holding `key`. The left and right trees built by the
+    // descent are kept: only node->left is splayed, to bring the predecessor
+    // up with an empty right link, and the split trees are hung under it.
+    // Returns nullptr (with the closest key splayed to the root) on a miss.
+    template <typename K>
+    Node* detach(const Probe<K>& key)
+    {
+        if (!root)
+            return nullptr;
+
+        Split split;
+        Node* node = descend(key, root, split);
+        if (!equal(key, node))
+        {
+            root = assemble(node, split);
+            return nullptr;
+        }
+
+        // Keys of node->left lie between LeftTreeMax and node, keys of
+        // node->right between node and RightTreeMin.
+        *split.RightTreeMin = node->right;
+
+        if (node->left)
+        {
+            Node* pred = splay_max(node->left);
+            *split.LeftTreeMax = pred->left;
+            pred->left = split.header_right;
+            pred->right = split.header_left;
+            root = pred;
+        }
+        else if (!split.LeftTreeMaxLink)
+        {
+            // nothing is less than the erased key
+            root = split.header_left;
+        }
         else
-            return search_(key, node->right);
+        {
+            // the predecessor is the left tree maximum
+            Node* pred = *split.LeftTreeMaxLink;
+            *split.LeftTreeMaxLink = pred->left;
+            pred->left = split.header_right;
+            pred->right = split.header_left;
+            root = pred;
+        }
+
+        node->left = nullptr;
+        node->right = nullptr;
+        return node;
+    }
+
+    // Most descents find_batch_() keeps in flight.
+    static constexpr std::size_t max_batch_group = 64;
+
+    void find_batch_(const key_type* keys, std::size_t count, const Node** results, int* depths, std::size_t group) const
+    {
+        struct Slot
+        {
+            std::size_t index;
+            std::uint64_t prefix;
+            const Node* node;
+            int depth;
+        };
+
+        Slot slots[max_batch_group];
+        group = std::max<std::size_t>(1, std::min({ group, max_batch_group, count }));
+
+        std::size_t next = 0;
+        std::size_t active = 0;
+        const auto start = [&](Slot& slot)
+        {
+            slot = Slot{ next, probe(keys[next]).prefix, root, 0 };
+            ++next;
+        };
+        for (; active < group && next < count; ++active)
+            start(slots[active]);
+        if (root)
+            detail::prefetch(root);
+
+        while (active)
+        {
+            for (std::size_t s = 0; s < active;)
+            {
+                Slot& slot = slots[s];
+                const Probe<key_type> key{ keys[slot.index], slot.prefix };
+                const Node* node = slot.node;
+                bool done = !node;
+                if (!done)
+                {
+                    if (less(key, node))
+                        node = node->left;
+                    else if (greater(key, node))
+                        node = node->right;
+                    else
+                        done = true;
+                }
+
+                if (!done)
+                {
+                    detail::prefetch(node);
+                    slot.node = node;
+                    ++slot.depth;
+                    ++s;
+                    continue;
+                }
+
+                results[slot.index] = node;
+                if (depths)
+                    depths[slot.index] = slot.depth;
+                if (next < count)
+                {
+                    start(slot);
+                    ++s;
+                }
+                else
+                    slot = slots[--active];
+            }
+        }
+    }
+
+    template <typename K>
+    Node* search_(const Probe<K>& key, Node* node) const
+    {
+        while (node)
+        {
+            if (less(key, node))
+                node = node->left;
+            else if (greater(key, node))
+                node = node->right;
+            else
+                return node;
+        }
+        return nullptr;
+    }
+
+    template <typename K>
+    const Node* lower_bound_(const Probe<K>& key) const
+    {
+        const Node* node = root;
+        const Node* bound = nullptr;
+        while (node)
+        {
+            if (greater(key, node))
+                node = node->right;
+            else
+            {
+                bound = node;
+                node = node->left;
+            }
+        }
+        return bound;
     }
 
     int height_(const Node* node) const
@@ -153,55 +1642,130 @@ private:
         return k1;
     }
 
-    Node* splay(int key, Node* node)
+    template <typename K>
+    Node* splay(const Probe<K>& key, Node* node)
     {
         if (!node)
             return nullptr;
 
-        Node header;
-        Node* LeftTreeMax = &header;
-        Node* RightTreeMin = &header;
+        Split split;
+        node = descend(key, node, split);
+        return assemble(node, split);
+    }
+
+    // Top-down part of splay(): walks towards `key` peeling the visited
+    // nodes off into the left/right trees of `split`. Returns the node the
+    // walk stopped at, which has not been linked to the split trees yet.
+    template <typename K>
+    Node* descend(const Probe<K>& key, Node* node, Split& split)
+    {
+        Node**& LeftTreeMax = split.LeftTreeMax;
+        Node**& RightTreeMin = split.RightTreeMin;
+        std::uint64_t depth = 0;
+        ++restructures_;
         while (1)
         {
-            if (key < node->number)
+            if (less(key, node))
             {
                 if (!node->left)
                     break;
-                if (key < node->left->number)
+                if (less(key, node->left))
                 {
                     node = RR_rotate(node);
+                    ++depth;
                     if (!node->left)
                         break;
                 }
-                RightTreeMin->left = node;
-                RightTreeMin = RightTreeMin->left;
+                *RightTreeMin = node;
+                RightTreeMin = &node->left;
                 node = node->left;
-                RightTreeMin->left = nullptr;
+                *RightTreeMin = nullptr;
+                ++depth;
             }
-            else if (key > node->number)
+            else if (greater(key, node))
             {
                 if (!node->right)
                     break;
-                if (key > node->right->number)
+                if (greater(key, node->right))
                 {
                     node = LL_rotate(node);
+                    ++depth;
                     if (!node->right)
                         break;
                 }
-                LeftTreeMax->right = node;
-                LeftTreeMax = LeftTreeMax->right;
+                split.LeftTreeMaxLink = LeftTreeMax;
+                *LeftTreeMax = node;
+                LeftTreeMax = &node->right;
                 node = node->right;
-                LeftTreeMax->right = nullptr;
+                *LeftTreeMax = nullptr;
+                ++depth;
             }
             else
                 break;
         }
-        LeftTreeMax->right = node->left;
-        RightTreeMin->left = node->right;
-        node->left = header.right;
-        node->right = header.left;
+        splay_depth_ += depth;
+        return node;
+    }
+
+    // splay() towards the least key: the node ends at the root with no
+    // left child.
+    Node* splay_min(Node* node)
+    {
+        Split split;
+        std::uint64_t depth = 0;
+        ++restructures_;
+        while (node->left)
+        {
+            if (node->left->left)
+            {
+                node = RR_rotate(node);
+                ++depth;
+            }
+            *split.RightTreeMin = node;
+            split.RightTreeMin = &node->left;
+            node = node->left;
+            *split.RightTreeMin = nullptr;
+            ++depth;
+        }
+        splay_depth_ += depth;
+        return assemble(node, split);
+    }
+
+    Node* splay_max(Node* node)
+    {
+        Split split;
+        std::uint64_t depth = 0;
+        ++restructures_;
+        while (node->right)
+        {
+            if (node->right->right)
+            {
+                node = LL_rotate(node);
+                ++depth;
+            }
+            split.LeftTreeMaxLink = split.LeftTreeMax;
+            *split.LeftTreeMax = node;
+            split.LeftTreeMax = &node->right;
+            node = node->right;
+            *split.LeftTreeMax = nullptr;
+            ++depth;
+        }
+        splay_depth_ += depth;
+        return assemble(node, split);
+    }
+
+    Node* assemble(Node* node, Split& split)
+    {
+        *split.LeftTreeMax = node->left;
+        *split.RightTreeMin = node->right;
+        node->left = split.header_right;
+        node->right = split.header_left;
         return node;
     }
-}; // class tree
+}; // class BasicTree
+
+
+using Node = BasicNode<int>;
+using Tree = BasicTree<int>;
 
 } // namespace splay
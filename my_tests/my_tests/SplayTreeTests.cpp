@@ -1,8 +1,15 @@
 #include "gtest/gtest.h"
 #include "SplayTree.h"
+#include "TestRandom.h"
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 #include <cstdio>
+#include <iterator>
+#include <set>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace
@@ -12,6 +19,70 @@ namespace
         int value;
         int height;
     };
+
+    struct Record
+    {
+        int id;
+        std::string name;
+    };
+
+    struct RecordId
+    {
+        const int& operator()(const Record& record) const
+        {
+            return record.id;
+        }
+    };
+
+    // Record that has no default constructor and counts its constructions.
+    struct Payload
+    {
+        explicit Payload(int id)
+            : id(id)
+        {
+            ++constructed;
+        }
+
+        int id;
+        std::vector<int> data = std::vector<int>(16, 0);
+
+        static int constructed;
+    };
+
+    int Payload::constructed = 0;
+
+    struct PayloadId
+    {
+        const int& operator()(const Payload& payload) const
+        {
+            return payload.id;
+        }
+    };
+
+    // Depth of `key` (the root is at 0) found without splaying, -1 if absent.
+    int Depth(splay::Tree& tree, int key)
+    {
+        int depth = 0;
+        for (const splay::Node* node = tree.get_root(); node; ++depth)
+        {
+            if (key < node->number)
+                node = node->left;
+            else if (key > node->number)
+                node = node->right;
+            else
+                return depth;
+        }
+        return -1;
+    }
+
+    // Drains the tree in key order through lower_bound.
+    std::vector<int> Keys(const splay::Tree& tree)
+    {
+        std::vector<int> keys;
+        for (const splay::Node* node = tree.lower_bound(INT_MIN); node; node = tree.lower_bound(node->number + 1))
+            keys.push_back(node->number);
+        return keys;
+    }
 } // anonymous namespace
 
 // ------------------------------------------------------------------------
@@ -489,4 +560,865 @@ TEST(SplayTree, TheMostComplexScenario)
     EXPECT_EQ(21, node_21->number);
     EXPECT_EQ(nullptr, node_21->left);
     EXPECT_EQ(nullptr, node_21->right);
-}
\ No newline at end of file
+}
+
+// ------------------------------------------------------------------------
+//      (5)                          (3)
+//      / \                          / \
+//    (3) (7)  ==(5)==>  ... ==>   (1) (7)
+//    /
+//  (1)
+TEST(SplayTree, Erase_PositiveCase_PredecessorBecomesRoot)
+{
+    // Initialization
+    std::vector<int> numbers{ 1, 7, 3, 5 };
+    splay::Tree tree;
+    for (const auto n : numbers)
+        EXPECT_TRUE(tree.insert(n));
+
+    // -----------------
+    EXPECT_EQ(5, tree.get_root()->number);
+    EXPECT_TRUE(tree.erase(5));
+    splay::Node* root = tree.get_root();
+    EXPECT_NE(nullptr, root);
+    EXPECT_EQ(3, root->number);
+    EXPECT_EQ(nullptr, tree.search(5));
+    for (const auto n : { 1, 3, 7 })
+    {
+        EXPECT_NE(nullptr, tree.search(n));
+        EXPECT_EQ(n, tree.get_root()->number);
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Erase_PositiveCase_EraseEveryOtherKey)
+{
+    // Initialization
+    const int count{ 200 };
+    splay::Tree tree;
+    for (int i = 0; i < count; ++i)
+        EXPECT_TRUE(tree.insert((i * 37) % count));
+
+    // -----------------
+    for (int i = 0; i < count; i += 2)
+        EXPECT_TRUE(tree.erase((i * 91) % count));
+    for (int i = 0; i < count; ++i)
+    {
+        const int key = (i * 91) % count;
+        if (i % 2 == 0)
+        {
+            EXPECT_EQ(nullptr, tree.search(key));
+            EXPECT_FALSE(tree.erase(key));
+        }
+        else
+        {
+            EXPECT_NE(nullptr, tree.search(key));
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Erase_PositiveCase_PredecessorIsSplayed)
+{
+    // Initialization
+    // (1) - (2) - ... - (n), then n + 1 halves the spine once: the left
+    // subtree of every erased key still has a long right spine
+    const int count{ 4000 };
+    splay::Tree tree;
+    for (int i = count; i >= 1; --i)
+        tree.insert(i);
+    tree.insert(count + 1);
+
+    // -----------------
+    // Erasing from the top, the predecessor is the maximum of the left
+    // subtree. Had it been found by walking the spine without splaying,
+    // its depth would stay about n / 2 and the sum below quadratic.
+    std::uint64_t pred_depth = 0;
+    const std::uint64_t splay_depth = tree.splay_depth();
+    for (int i = count + 1; i > 1; --i)
+    {
+        pred_depth += Depth(tree, i - 1);
+        EXPECT_TRUE(tree.erase(i));
+        EXPECT_EQ(i - 1, tree.get_root()->number);
+    }
+    EXPECT_GT(20u * count, pred_depth);
+    EXPECT_GT(40u * count, tree.splay_depth() - splay_depth);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Extract_NegativeCase)
+{
+    splay::Tree tree;
+    EXPECT_TRUE(tree.extract(1).empty());
+
+    EXPECT_TRUE(tree.insert(1));
+    splay::Tree::node_type handle = tree.extract(2);
+    EXPECT_TRUE(handle.empty());
+    EXPECT_FALSE(handle);
+    EXPECT_FALSE(tree.insert(std::move(handle)));
+    EXPECT_EQ(1, tree.height());
+}
+
+// ------------------------------------------------------------------------
+//   (1)                     (2)
+//     \        ==(3)==>     /      + [3]
+//     (2)                 (1)
+//       \
+//       (3)
+TEST(SplayTree, Extract_PositiveCase)
+{
+    // Initialization
+    std::vector<int> numbers{ 3, 2, 1 };
+    splay::Tree tree;
+    for (const auto n : numbers)
+        EXPECT_TRUE(tree.insert(n));
+
+    // -----------------
+    splay::Tree::node_type handle = tree.extract(3);
+    EXPECT_FALSE(handle.empty());
+    EXPECT_EQ(3, handle.value());
+    EXPECT_EQ(2, tree.get_root()->number);
+    EXPECT_EQ(2, tree.height());
+    EXPECT_EQ(nullptr, tree.search(3));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Extract_MoveNodeBetweenTrees)
+{
+    // Initialization
+    splay::Tree source;
+    splay::Tree target;
+    for (const auto n : { 1, 2, 3 })
+        EXPECT_TRUE(source.insert(n));
+    EXPECT_TRUE(target.insert(2));
+
+    // -----------------
+    splay::Node* node = source.search(2);
+    EXPECT_NE(nullptr, node);
+    splay::Tree::node_type handle = source.extract(2);
+    EXPECT_FALSE(target.insert(std::move(handle)));
+    EXPECT_FALSE(handle.empty());
+
+    handle.value() = 4;
+    EXPECT_TRUE(target.insert(std::move(handle)));
+    EXPECT_TRUE(handle.empty());
+    EXPECT_EQ(node, target.get_root());
+    EXPECT_EQ(4, node->number);
+    EXPECT_NE(nullptr, target.search(2));
+    EXPECT_EQ(node, target.search(4));
+    EXPECT_EQ(nullptr, source.search(2));
+}
+
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Transparent_StringViewLookup)
+{
+    // Initialization
+    // std::string is not implicitly constructible from std::string_view,
+    // so the calls below compile only through the transparent overloads.
+    splay::BasicTree<std::string, std::less<>> tree;
+    for (const auto* id : { "user:42", "user:7", "order:1", "user:100" })
+        EXPECT_TRUE(tree.insert(std::string(id)));
+
+    // -----------------
+    const std::string_view key{ "user:7" };
+    EXPECT_TRUE(tree.contains(key));
+    EXPECT_FALSE(tree.contains(std::string_view("user:8")));
+    EXPECT_EQ(nullptr, tree.find(std::string_view("user:8")));
+
+    auto* node = tree.search(key);
+    EXPECT_NE(nullptr, node);
+    EXPECT_EQ("user:7", node->number);
+    EXPECT_EQ(node, tree.get_root());
+
+    const auto* bound = tree.lower_bound(std::string_view("user:5"));
+    EXPECT_NE(nullptr, bound);
+    EXPECT_EQ("user:7", bound->number);
+    EXPECT_EQ(nullptr, tree.lower_bound(std::string_view("v")));
+
+    EXPECT_TRUE(tree.erase(key));
+    EXPECT_FALSE(tree.erase(key));
+    EXPECT_FALSE(tree.contains(key));
+    EXPECT_EQ("order:1", tree.extract(std::string_view("order:1")).value());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Projection_RecordsKeyedById)
+{
+    // Initialization
+    splay::BasicTree<Record, std::less<>, RecordId> tree;
+    EXPECT_TRUE(tree.insert(Record{ 3, "three" }));
+    EXPECT_TRUE(tree.insert(Record{ 1, "one" }));
+    EXPECT_TRUE(tree.insert(Record{ 2, "two" }));
+    EXPECT_FALSE(tree.insert(Record{ 2, "second two" }));
+
+    // -----------------
+    auto* node = tree.search(2);
+    EXPECT_NE(nullptr, node);
+    EXPECT_EQ("two", node->number.name);
+    EXPECT_TRUE(tree.contains(3));
+    EXPECT_FALSE(tree.contains(4));
+
+    // find() reads without splaying, like StaticTree::find()
+    const auto& view = tree;
+    const Record* found = view.find(3);
+    EXPECT_NE(nullptr, found);
+    EXPECT_EQ("three", found->name);
+    EXPECT_EQ(nullptr, view.find(4));
+    EXPECT_EQ(node, tree.get_root());
+
+    EXPECT_EQ(1, tree.lower_bound(0)->number.id);
+    EXPECT_TRUE(tree.erase(1));
+    EXPECT_EQ(2, tree.lower_bound(0)->number.id);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Projection_PayloadWithoutDefaultConstructor)
+{
+    // Initialization
+    splay::BasicTree<Payload, std::less<>, PayloadId> tree;
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(tree.insert(Payload(i)));
+
+    // -----------------
+    // splays build their side trees out of links only
+    Payload::constructed = 0;
+    for (int i = 0; i < 100; ++i)
+        EXPECT_NE(nullptr, tree.search((i * 37) % 100));
+    EXPECT_TRUE(tree.erase(50));
+    EXPECT_EQ(0, tree.pop_min().value().id);
+    splay::BasicTree<Payload, std::less<>, PayloadId>::Handle handle = tree.find_handle(10);
+    EXPECT_TRUE(tree.update_key(handle, Payload(1000)));
+    EXPECT_EQ(1, Payload::constructed);
+
+    EXPECT_FALSE(tree.contains(50));
+    EXPECT_FALSE(tree.contains(10));
+    EXPECT_EQ(1000, tree.pop_max().value().id);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Prefix_StringPrefixPreservesOrder)
+{
+    const splay::StringPrefix prefix_of;
+    EXPECT_LT(prefix_of(std::string("a")), prefix_of(std::string("b")));
+    EXPECT_LT(prefix_of(std::string("ab")), prefix_of(std::string("abc")));
+    EXPECT_LT(prefix_of(std::string("a\x7f")), prefix_of(std::string("a\x80")));
+    EXPECT_EQ(prefix_of(std::string("https://a")), prefix_of(std::string("https://b")));
+    EXPECT_EQ(0u, prefix_of(std::string()));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Prefix_UrlAndUuidKeys)
+{
+    // Initialization
+    // URLs share long prefixes (ties resolved on the full key), UUIDs are
+    // decided by the cached prefix almost always.
+    std::vector<std::string> keys;
+    const char* hex = "0123456789abcdef";
+    for (int i = 0; i < 300; ++i)
+    {
+        keys.push_back("https://example.com/api/v1/items/" + std::to_string((i * 7919) % 1000));
+        std::string uuid = "xxxxxxxx-xxxx-4xxx-8xxx-xxxxxxxxxxxx";
+        test::Random random(static_cast<unsigned>(i) * 2654435761u + 1u);
+        for (auto& c : uuid)
+        {
+            if (c == 'x')
+                c = hex[random.next(16)];
+        }
+        keys.push_back(uuid);
+    }
+
+    splay::BasicTree<std::string, std::less<>> plain;
+    splay::BasicTree<std::string, std::less<>, splay::Identity, splay::StringPrefix> cached;
+
+    // -----------------
+    for (const auto& key : keys)
+        EXPECT_EQ(plain.insert(key), cached.insert(key));
+    for (std::size_t i = 0; i < keys.size(); i += 3)
+        EXPECT_EQ(plain.erase(keys[i]), cached.erase(keys[i]));
+    for (const auto& key : keys)
+    {
+        const std::string_view view(key);
+        EXPECT_EQ(plain.contains(view), cached.contains(view));
+        EXPECT_EQ(nullptr == plain.search(view), nullptr == cached.search(view));
+
+        const std::string missing = key + "/";
+        const auto* plain_bound = plain.lower_bound(missing);
+        const auto* cached_bound = cached.lower_bound(missing);
+        EXPECT_EQ(nullptr == plain_bound, nullptr == cached_bound);
+        if (plain_bound && cached_bound)
+        {
+            EXPECT_EQ(plain_bound->number, cached_bound->number);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Assign_BuildsBalancedTree)
+{
+    splay::Tree tree;
+    EXPECT_TRUE(tree.insert(-1));
+
+    tree.assign({ 5, 3, 9, 1, 3, 7, 5 });
+    EXPECT_EQ((std::vector<int>{ 1, 3, 5, 7, 9 }), Keys(tree));
+    EXPECT_EQ(3, tree.height());
+    EXPECT_FALSE(tree.contains(-1));
+
+    tree.assign({});
+    EXPECT_EQ(nullptr, tree.get_root());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Assign_Parallel)
+{
+    const std::vector<int> keys = test::RandomKeys(100000, 60000, 1u);
+    const std::set<int> expected(keys.begin(), keys.end());
+
+    for (const unsigned threads : { 1u, 4u, 7u })
+    {
+        splay::Tree tree;
+        tree.assign(keys, threads);
+        EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), Keys(tree));
+        EXPECT_EQ(16, tree.height());
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Assign_StringPrefixTree)
+{
+    // Initialization
+    // keys longer than any small-string buffer, so a moved-from key is empty
+    std::vector<std::string> urls;
+    for (int i = 0; i < 100; ++i)
+        urls.push_back("https://example.com/items/" + std::to_string(i * 7919));
+
+    splay::BasicTree<std::string, std::less<>, splay::Identity, splay::StringPrefix> tree;
+
+    // -----------------
+    tree.assign(urls);
+    const splay::StringPrefix prefix_of;
+    for (const auto& url : urls)
+    {
+        EXPECT_TRUE(tree.contains(std::string_view(url)));
+        EXPECT_TRUE(tree.search(url) != nullptr);
+        EXPECT_EQ(prefix_of(url), tree.get_root()->prefix);
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, SetAlgebra_SmallTrees)
+{
+    splay::Tree a;
+    splay::Tree b;
+    for (const auto n : { 1, 2, 3, 4 })
+        EXPECT_TRUE(a.insert(n));
+    for (const auto n : { 3, 4, 5 })
+        EXPECT_TRUE(b.insert(n));
+
+    a.unite(std::move(b));
+    EXPECT_EQ((std::vector<int>{ 1, 2, 3, 4, 5 }), Keys(a));
+    EXPECT_EQ(nullptr, b.get_root());
+
+    for (const auto n : { 0, 2, 4, 6 })
+        EXPECT_TRUE(b.insert(n));
+    a.intersect(std::move(b));
+    EXPECT_EQ((std::vector<int>{ 2, 4 }), Keys(a));
+
+    for (const auto n : { 4, 8 })
+        EXPECT_TRUE(b.insert(n));
+    a.subtract(std::move(b));
+    EXPECT_EQ((std::vector<int>{ 2 }), Keys(a));
+
+    a.subtract(splay::Tree());
+    EXPECT_EQ((std::vector<int>{ 2 }), Keys(a));
+    a.intersect(splay::Tree());
+    EXPECT_EQ(nullptr, a.get_root());
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, SetAlgebra_Parallel)
+{
+    const std::vector<int> left_keys = test::RandomKeys(80000, 200000, 2u);
+    const std::vector<int> right_keys = test::RandomKeys(50000, 200000, 3u);
+    const std::set<int> left(left_keys.begin(), left_keys.end());
+    const std::set<int> right(right_keys.begin(), right_keys.end());
+
+    std::vector<int> united;
+    std::vector<int> common;
+    std::vector<int> difference;
+    std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(united));
+    std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(common));
+    std::set_difference(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(difference));
+
+    for (const unsigned threads : { 1u, 3u, 8u })
+    {
+        splay::Tree a;
+        splay::Tree b;
+
+        a.assign(left_keys, threads);
+        for (const auto n : right_keys)
+            b.insert(n);
+        a.unite(std::move(b), threads);
+        EXPECT_EQ(united, Keys(a));
+
+        a.assign(left_keys, threads);
+        b.assign(right_keys, threads);
+        a.intersect(std::move(b), threads);
+        EXPECT_EQ(common, Keys(a));
+
+        a.assign(left_keys, threads);
+        b.assign(right_keys, threads);
+        a.subtract(std::move(b), threads);
+        EXPECT_EQ(difference, Keys(a));
+        EXPECT_EQ(nullptr, b.get_root());
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, SetAlgebra_ParallelFreesSlabNodes)
+{
+    // Initialization
+    // both trees live in slabs, so the dropped nodes go back to the free
+    // lists from four parts at once
+    const int count{ 100000 };
+    splay::Tree a;
+    splay::Tree b;
+    for (int i = 0; i < count; ++i)
+    {
+        a.insert(i);
+        if (i % 2 == 0)
+            b.insert(i);
+    }
+    a.compact();
+    b.compact();
+
+    // -----------------
+    a.subtract(std::move(b), 4);
+    std::vector<int> odd;
+    for (int i = 1; i < count; i += 2)
+        odd.push_back(i);
+    EXPECT_EQ(odd, Keys(a));
+
+    // the slab of `b` is empty and released, the one of `a` half free
+    splay::MemoryUsage usage = a.memory_usage();
+    EXPECT_EQ(odd.size(), usage.live_nodes);
+    EXPECT_EQ(0u, usage.heap_nodes);
+    EXPECT_EQ(static_cast<std::size_t>(count) - odd.size(), usage.slab_free_slots);
+
+    for (int i = 0; i < count; i += 2)
+        a.insert(i);
+    usage = a.memory_usage();
+    EXPECT_EQ(static_cast<std::size_t>(count), usage.live_nodes);
+    EXPECT_EQ(0u, usage.heap_nodes);
+    EXPECT_EQ(0u, usage.slab_free_slots);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, FindBatch_MatchesSearch)
+{
+    // Initialization
+    splay::Tree tree;
+    for (const auto n : test::RandomKeys(5000, 20000, 4u))
+        tree.insert(n);
+    const std::vector<int> keys = test::RandomKeys(3000, 20000, 5u);
+
+    // -----------------
+    for (const std::size_t group : { 1u, 3u, 16u, 1000u })
+    {
+        std::vector<const splay::Node*> results(keys.size(), nullptr);
+        const splay::Node* root = tree.get_root();
+        tree.find_batch(keys.data(), keys.size(), results.data(), group);
+        EXPECT_EQ(root, tree.get_root());
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+            EXPECT_EQ(tree.contains(keys[i]), results[i] != nullptr);
+            if (results[i])
+            {
+                EXPECT_EQ(keys[i], results[i]->number);
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, SearchBatch_SplaysDeepHits)
+{
+    // Initialization
+    // (1) - (2) - ... - (64): a spine, the deepest key is 64
+    splay::Tree tree;
+    for (int i = 64; i >= 1; --i)
+        EXPECT_TRUE(tree.insert(i));
+    EXPECT_EQ(64, tree.height());
+
+    // -----------------
+    const std::vector<int> keys{ 2, 64, 100 };
+    std::vector<splay::Node*> results(keys.size(), nullptr);
+    tree.search_batch(keys.data(), keys.size(), results.data(), 8);
+    EXPECT_NE(nullptr, results[0]);
+    EXPECT_NE(nullptr, results[1]);
+    EXPECT_EQ(nullptr, results[2]);
+    EXPECT_EQ(results[1], tree.get_root());
+    EXPECT_GT(64, tree.height());
+
+    splay::Tree empty;
+    empty.search_batch(keys.data(), keys.size(), results.data());
+    EXPECT_EQ(nullptr, results[0]);
+    EXPECT_EQ(nullptr, results[1]);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Compact_InOrderRemovesScatter)
+{
+    // Initialization
+    splay::Tree tree;
+    const std::vector<int> keys = test::RandomKeys(3000, 50000, 6u);
+    for (const auto n : keys)
+        tree.insert(n);
+    const std::vector<int> expected = Keys(tree);
+
+    splay::MemoryUsage usage = tree.memory_usage();
+    EXPECT_EQ(expected.size(), usage.live_nodes);
+    EXPECT_EQ(expected.size(), usage.heap_nodes);
+    EXPECT_EQ(0u, usage.slab_nodes);
+    EXPECT_GT(usage.scatter, 0.5);
+
+    // -----------------
+    tree.compact();
+    usage = tree.memory_usage();
+    EXPECT_EQ(expected.size(), usage.live_nodes);
+    EXPECT_EQ(0u, usage.heap_nodes);
+    EXPECT_EQ(expected.size(), usage.slab_nodes);
+    EXPECT_EQ(0u, usage.slab_free_slots);
+    EXPECT_EQ(0.0, usage.scatter);
+    EXPECT_EQ(0.0, usage.fragmentation);
+    EXPECT_EQ(expected, Keys(tree));
+
+    // erased slots are refilled before the heap grows
+    for (std::size_t i = 0; i < 100; ++i)
+        EXPECT_TRUE(tree.erase(expected[i * 10]));
+    usage = tree.memory_usage();
+    EXPECT_EQ(100u, usage.slab_free_slots);
+    EXPECT_GT(usage.fragmentation, 0.0);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(tree.insert(50000 + i));
+    usage = tree.memory_usage();
+    EXPECT_EQ(0u, usage.heap_nodes);
+    EXPECT_EQ(0u, usage.slab_free_slots);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Compact_IncrementalWithUpdates)
+{
+    // Initialization
+    splay::Tree tree;
+    std::set<int> expected;
+    for (const auto n : test::RandomKeys(2000, 10000, 7u))
+    {
+        tree.insert(n);
+        expected.insert(n);
+    }
+
+    // -----------------
+    // keys churn between steps; every key ends up either relocated or
+    // inserted behind the cursor into the heap
+    tree.compact_begin();
+    const std::vector<int> churn = test::RandomKeys(400, 10000, 8u);
+    std::size_t steps = 0;
+    for (bool done = false; !done; ++steps)
+    {
+        done = tree.compact_step(50);
+        const int key = churn[steps % churn.size()];
+        if (steps % 2)
+        {
+            EXPECT_EQ(expected.insert(key).second, tree.insert(key));
+        }
+        else
+        {
+            EXPECT_EQ(expected.erase(key) == 1, tree.erase(key));
+        }
+        tree.search(churn[(steps * 7) % churn.size()]);
+    }
+    EXPECT_GT(steps, 10u);
+    EXPECT_TRUE(tree.compact_step(50));
+    EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), Keys(tree));
+
+    const splay::MemoryUsage usage = tree.memory_usage();
+    EXPECT_EQ(expected.size(), usage.live_nodes);
+    EXPECT_GT(usage.slab_nodes, usage.heap_nodes);
+
+    // a second pass moves everything, old slab included, into a new one
+    tree.compact();
+    EXPECT_EQ(0u, tree.memory_usage().heap_nodes);
+    EXPECT_EQ(0u, tree.memory_usage().slab_free_slots);
+    EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), Keys(tree));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Compact_SpineIsLinear)
+{
+    // Initialization
+    // (100000) - (99999) - ... - (1): relocating every node by a fresh
+    // descent from the root would follow about 5 * 10^9 links
+    const int count{ 100000 };
+    splay::Tree tree;
+    for (int i = 1; i <= count; ++i)
+        tree.insert(i);
+    EXPECT_EQ(count - 1, Depth(tree, 1));
+
+    // -----------------
+    // one link per node: the seek runs down the spine, each relocation
+    // pushes the empty left side of the next node
+    tree.compact();
+    EXPECT_GE(static_cast<std::uint64_t>(count), tree.compact_links());
+    EXPECT_EQ(count - 1, Depth(tree, 1));
+    EXPECT_EQ(0.0, tree.memory_usage().scatter);
+
+    // steps of one node interleaved with splays keep going where they were
+    tree.compact_begin();
+    std::size_t steps = 0;
+    while (!tree.compact_step(1))
+    {
+        if (++steps % 1000 == 0)
+            tree.search(static_cast<int>(steps));
+    }
+    EXPECT_EQ(static_cast<std::size_t>(count), steps + 1);
+    EXPECT_GT(5 * static_cast<std::uint64_t>(count), tree.compact_links());
+    EXPECT_EQ(0u, tree.memory_usage().heap_nodes);
+    EXPECT_EQ(0u, tree.memory_usage().slab_free_slots);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Compact_VanEmdeBoasRebalances)
+{
+    // Initialization
+    // (1) - (2) - ... - (1023): a spine
+    splay::Tree tree;
+    for (int i = 1; i < 1024; ++i)
+        tree.insert(i);
+    EXPECT_EQ(1023, tree.height());
+
+    // -----------------
+    // the 1023 nodes form a perfect tree of 10 levels: the root is the
+    // first slot and the top 5 levels take the first 31 slots
+    tree.compact(splay::NodeLayout::VanEmdeBoas);
+    EXPECT_EQ(10, tree.height());
+    const splay::Node* root = tree.get_root();
+    EXPECT_EQ(512, root->number);
+    EXPECT_EQ(root + 1, root->left);
+    EXPECT_EQ(root + 2, root->right);
+    EXPECT_EQ(root + 3, root->left->left);
+    const splay::Node* top = root->left->left->left->left;
+    EXPECT_EQ(32, top->number);
+    EXPECT_GT(root + 31, top);
+    EXPECT_EQ(0u, tree.memory_usage().heap_nodes);
+    EXPECT_EQ(0u, tree.memory_usage().slab_free_slots);
+
+    std::vector<int> expected;
+    for (int i = 1; i < 1024; ++i)
+        expected.push_back(i);
+    EXPECT_EQ(expected, Keys(tree));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Compact_ExtractAndUnite)
+{
+    // Initialization
+    splay::Tree a;
+    splay::Tree b;
+    for (int i = 0; i < 1000; ++i)
+    {
+        a.insert(2 * i);
+        b.insert(3 * i);
+    }
+    a.compact();
+    b.compact(splay::NodeLayout::VanEmdeBoas);
+
+    // -----------------
+    // handles carry heap nodes, whatever the node lived in
+    splay::Tree::node_type handle = a.extract(10);
+    EXPECT_FALSE(handle.empty());
+    EXPECT_EQ(10, handle.value());
+    EXPECT_EQ(1u, a.memory_usage().slab_free_slots);
+    EXPECT_TRUE(b.insert(std::move(handle)));
+    EXPECT_EQ(1u, b.memory_usage().heap_nodes);
+
+    std::set<int> expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i != 5)
+            expected.insert(2 * i);
+        expected.insert(3 * i);
+    }
+    expected.insert(10);
+
+    // the slabs of `b` follow its nodes, the dropped duplicates are freed
+    a.unite(std::move(b), 2);
+    EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()), Keys(a));
+    const splay::MemoryUsage usage = a.memory_usage();
+    EXPECT_EQ(expected.size(), usage.live_nodes);
+    EXPECT_EQ(1u, usage.heap_nodes);
+    EXPECT_EQ(nullptr, b.get_root());
+    EXPECT_EQ(0u, b.memory_usage().reserved_bytes);
+
+    splay::Tree moved(std::move(a));
+    EXPECT_EQ(expected.size(), moved.memory_usage().live_nodes);
+    moved.clear();
+    EXPECT_EQ(0u, moved.memory_usage().reserved_bytes);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Handle_StableAcrossSplays)
+{
+    // Initialization
+    splay::Tree tree;
+    for (const auto n : test::RandomKeys(500, 2000, 9u))
+        tree.insert(n);
+    tree.insert(1000);
+
+    // -----------------
+    const splay::Tree::Handle handle = tree.find_handle(1000);
+    EXPECT_FALSE(handle.empty());
+    EXPECT_EQ(1000, handle.key());
+    EXPECT_TRUE(tree.find_handle(-1).empty());
+
+    for (const auto n : test::RandomKeys(200, 2000, 10u))
+        tree.search(n);
+    EXPECT_EQ(1000, *tree.get(handle));
+    EXPECT_TRUE(handle == tree.find_handle(1000));
+
+    EXPECT_TRUE(tree.erase(handle));
+    EXPECT_FALSE(tree.contains(1000));
+    EXPECT_FALSE(tree.erase(splay::Tree::Handle()));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Handle_UpdateKeyKeepsNode)
+{
+    // Initialization
+    //       (30)
+    //      /    \
+    //    (20)   (40)
+    //    /
+    //  (10)
+    splay::Tree tree;
+    for (const auto n : { 10, 20, 30, 40 })
+        tree.insert(n);
+
+    // -----------------
+    splay::Tree::Handle handle = tree.find_handle(20);
+    const splay::Node* node = tree.get_root();
+
+    // increase past every key
+    EXPECT_TRUE(tree.update_key(handle, 50));
+    EXPECT_EQ(node, tree.get_root());
+    EXPECT_EQ(50, handle.key());
+    EXPECT_FALSE(tree.contains(20));
+    EXPECT_EQ((std::vector<int>{ 10, 30, 40, 50 }), Keys(tree));
+
+    // decrease below every key
+    EXPECT_TRUE(tree.update_key(handle, 5));
+    EXPECT_EQ(handle, tree.find_handle(5));
+    EXPECT_EQ((std::vector<int>{ 5, 10, 30, 40 }), Keys(tree));
+
+    // the new key is taken: nothing changes
+    EXPECT_FALSE(tree.update_key(handle, 30));
+    EXPECT_EQ(5, *tree.get(handle));
+    EXPECT_EQ((std::vector<int>{ 5, 10, 30, 40 }), Keys(tree));
+
+    splay::Tree::Handle empty;
+    EXPECT_FALSE(tree.update_key(empty, 1));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, Handle_StaleIsRefused)
+{
+    // Initialization
+    splay::Tree tree;
+    for (int i = 0; i < 100; ++i)
+        tree.insert(i);
+    tree.compact();
+
+    // -----------------
+    // the erased node's slab slot is reused by the next insert
+    splay::Tree::Handle handle = tree.find_handle(50);
+    EXPECT_TRUE(tree.erase(50));
+    EXPECT_TRUE(tree.insert(55 + 100));
+    EXPECT_EQ(nullptr, tree.get(handle));
+    EXPECT_FALSE(tree.update_key(handle, 1000));
+    EXPECT_FALSE(tree.erase(handle));
+    EXPECT_TRUE(tree.contains(155));
+    EXPECT_FALSE(tree.contains(1000));
+
+    // heap nodes: the freed node is never dereferenced
+    tree.insert(200);
+    handle = tree.find_handle(200);
+    EXPECT_TRUE(tree.erase(200));
+    EXPECT_EQ(nullptr, tree.get(handle));
+    EXPECT_FALSE(tree.update_key(handle, 201));
+    EXPECT_FALSE(tree.contains(201));
+
+    // compaction moves every node
+    handle = tree.find_handle(10);
+    tree.compact();
+    EXPECT_EQ(nullptr, tree.get(handle));
+    EXPECT_FALSE(tree.erase(handle));
+    EXPECT_TRUE(tree.contains(10));
+
+    // extracted and reinserted: a new node of the same key
+    handle = tree.find_handle(20);
+    splay::Tree::node_type node = tree.extract(20);
+    EXPECT_EQ(nullptr, tree.get(handle));
+    EXPECT_TRUE(tree.insert(std::move(node)));
+    EXPECT_EQ(nullptr, tree.get(handle));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayTree, PriorityQueue_PopMinMax)
+{
+    // Initialization
+    splay::Tree tree;
+    std::set<int> expected;
+    for (const auto n : test::RandomKeys(3000, 100000, 11u))
+    {
+        tree.insert(n);
+        expected.insert(n);
+    }
+
+    // -----------------
+    // decrease-key traffic interleaved with pops from both ends
+    std::vector<int> keys(expected.begin(), expected.end());
+    for (std::size_t i = 0; i < keys.size(); i += 7)
+    {
+        const int key = keys[i] - 50000;
+        if (expected.count(key))
+            continue;
+        splay::Tree::Handle handle = tree.find_handle(keys[i]);
+        EXPECT_TRUE(tree.update_key(handle, key));
+        expected.erase(keys[i]);
+        expected.insert(key);
+    }
+
+    while (!expected.empty())
+    {
+        splay::Tree::node_type min = tree.pop_min();
+        EXPECT_EQ(*expected.begin(), min.value());
+        expected.erase(expected.begin());
+        if (expected.empty())
+            break;
+
+        splay::Tree::node_type max = tree.pop_max();
+        EXPECT_EQ(*expected.rbegin(), max.value());
+        expected.erase(std::prev(expected.end()));
+    }
+    EXPECT_EQ(nullptr, tree.get_root());
+    EXPECT_TRUE(tree.pop_min().empty());
+    EXPECT_TRUE(tree.pop_max().empty());
+
+    // (1) - (2) - ... - (64): popping the deepest key flattens the spine
+    // the way search() does
+    for (int i = 64; i >= 1; --i)
+        tree.insert(i);
+    EXPECT_EQ(64, tree.height());
+    EXPECT_EQ(64, tree.pop_max().value());
+    EXPECT_GT(64, tree.height());
+}
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace splay
+{
+
+struct WeightedNode
+{
+    WeightedNode()
+        : number(0)
+        , weight(0)
+        , left(nullptr)
+        , right(nullptr)
+    {
+    }
+
+    WeightedNode(int n, std::uint32_t w)
+        : number(n)
+        , weight(w)
+        , left(nullptr)
+        , right(nullptr)
+    {
+    }
+
+    int number { 0 };
+    std::uint32_t weight { 0 };
+    WeightedNode* left { nullptr };
+    WeightedNode* right { nullptr };
+}; // struct WeightedNode
+
+
+// Biased splay tree of int keys with per-key access weights.
+//
+// Weights are bucketed by magnitude into at most 33 levels (level of w is
+// the bit width of w: 0, 1, 2-3, 4-7, ...) and nodes are heap ordered by
+// level: no node ever sits above one of a higher level. Along any path
+// the levels only go down, so a path is a few segments of one level each.
+// An access splays the node among the nodes of its own level, then the
+// bottom node of every segment above it among its level, so each level
+// keeps the amortized O(log n) bound of a splay tree and an access costs
+// O(log n) per level crossed. Keys declared hot stay in the top levels
+// whatever the cold traffic does. With all weights in one level (e.g. the
+// default 0) this is a plain bottom-up splay tree.
+//
+// That guarantee is what it is for, not speed: on the Zipf workload of
+// "trace replay.cpp" (1M keys, 2M searches, exponent 1, weights = search
+// counts) a search took 673 ns at p50 against 340 ns with splay::Tree,
+// the cost of the level checks and of recording the path.
+class WeightedTree
+{
+public:
+    using Node = WeightedNode;
+
+    WeightedTree() = default;
+
+    WeightedTree(WeightedTree&& other) noexcept
+        : root(other.root)
+        , splay_depth_(other.splay_depth_)
+    {
+        other.root = nullptr;
+    }
+
+    WeightedTree& operator=(WeightedTree&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            root = other.root;
+            splay_depth_ = other.splay_depth_;
+            other.root = nullptr;
+        }
+        return *this;
+    }
+
+    WeightedTree(const WeightedTree&) = delete;
+    WeightedTree& operator=(const WeightedTree&) = delete;
+
+    ~WeightedTree()
+    {
+        clear();
+    }
+
+    bool insert(int number, std::uint32_t weight = 0)
+    {
+        if (descend(number))
+        {
+            // such value is already exist
+            splay_path();
+            return false;
+        }
+
+        *path.back() = new Node(number, weight);
+        splay_path();
+        return true;
+    }
+
+    Node* search(int number)
+    {
+        const bool found = descend(number);
+        if (!found)
+        {
+            // splay the last node visited, as splay::Tree does on a miss
+            path.pop_back();
+            if (path.empty())
+                return nullptr;
+        }
+        Node* node = *path.back();
+        splay_path();
+        return found ? node : nullptr;
+    }
+
+    bool contains(int number) const
+    {
+        return depth(number) >= 0;
+    }
+
+    // Depth of the key (the root is at 0), or -1 if absent. Non-splaying.
+    int depth(int number) const
+    {
+        int result = 0;
+        for (const Node* node = root; node; ++result)
+        {
+            if (number < node->number)
+                node = node->left;
+            else if (number > node->number)
+                node = node->right;
+            else
+                return result;
+        }
+        return -1;
+    }
+
+    // Bottom-up splay erase: the node is rotated down to at most one
+    // child and unlinked, then its last parent is splayed along the whole
+    // path walked, descent and rotations included.
+    bool erase(int number)
+    {
+        if (!descend(number))
+        {
+            // splay the last node visited, as search() does on a miss
+            path.pop_back();
+            splay_path();
+            return false;
+        }
+
+        sink(true);
+        Node* node = *path.back();
+        *path.back() = node->left ? node->left : node->right;
+        delete node;
+        path.pop_back();
+        splay_path();
+        return true;
+    }
+
+    // Changes the weight of a key and moves it to the place its new weight
+    // entitles it to. Returns false if there is no such key.
+    bool set_weight(int number, std::uint32_t weight)
+    {
+        if (!descend(number))
+            return false;
+
+        Node* node = *path.back();
+        const int old_level = level(node->weight);
+        node->weight = weight;
+
+        // a lighter node first goes below its heavier children; it stays
+        // under them while the rest of the path is splayed
+        if (level(weight) < old_level)
+            sink(false);
+        splay_path();
+        return true;
+    }
+
+    void clear()
+    {
+        while (root)
+        {
+            if (root->left)
+            {
+                Node* k1 = root->left;
+                root->left = k1->right;
+                k1->right = root;
+                root = k1;
+            }
+            else
+            {
+                Node* next = root->right;
+                delete root;
+                root = next;
+            }
+        }
+    }
+
+    int height() const
+    {
+        return height_(root);
+    }
+
+    // Total depth of the nodes splayed so far, as splay::Tree counts it.
+    std::uint64_t splay_depth() const
+    {
+        return splay_depth_;
+    }
+
+    Node* get_root()
+    {
+        return root;
+    }
+
+private:
+    Node* root = {nullptr};
+    std::uint64_t splay_depth_ = 0;
+
+    // Links from the root to the current node: *path[0] is the root and
+    // *path[i] the node at depth i. Kept as a member to reuse its storage.
+    std::vector<Node**> path;
+
+    // Fills `path` down to `number`; the last link holds the node found,
+    // or is the null link where it would be inserted.
+    bool descend(int number)
+    {
+        path.clear();
+        Node** link = &root;
+        path.push_back(link);
+        while (*link)
+        {
+            Node* node = *link;
+            if (number < node->number)
+                link = &node->left;
+            else if (number > node->number)
+                link = &node->right;
+            else
+                return true;
+            path.push_back(link);
+        }
+        return false;
+    }
+
+    // Rotates the node at depth i over its parent. Deeper links of `path`
+    // stay valid because they point into the rotated node's other side.
+    void rotate_up(std::size_t i)
+    {
+        Node** link = path[i - 1];
+        Node* parent = *link;
+        Node* child = *path[i];
+        if (parent->left == child)
+        {
+            parent->left = child->right;
+            child->right = parent;
+        }
+        else
+        {
+            parent->right = child->left;
+            child->left = parent;
+        }
+        *link = child;
+        path.erase(path.begin() + i);
+    }
+
+    // Weight bucket: the bit width of the weight.
+    static int level(std::uint32_t weight)
+    {
+        int result = 0;
+        for (; weight; weight >>= 1)
+            ++result;
+        return result;
+    }
+
+    // Splays the last node of `path` up, then the bottom node of each
+    // level segment above it. Empties `path`.
+    void splay_path()
+    {
+        if (!path.empty())
+            splay_depth_ += path.size() - 1;
+        while (!path.empty())
+        {
+            splay_up();
+            path.pop_back();
+        }
+    }
+
+    // Lifts the last node of `path` over every ancestor of a lower level,
+    // then splays it among the ancestors of its own level.
+    void splay_up()
+    {
+        std::size_t depth = path.size() - 1;
+        const int node_level = level((*path[depth])->weight);
+        while (depth > 0)
+        {
+            const int parent_level = level((*path[depth - 1])->weight);
+            if (parent_level > node_level)
+                break;
+
+            const Node* parent = *path[depth - 1];
+            const Node* grand = (depth > 1) ? *path[depth - 2] : nullptr;
+            if (parent_level == node_level && grand && level(grand->weight) == node_level)
+            {
+                const bool zig_zig = (grand->left == parent) == (parent->left == *path[depth]);
+                if (zig_zig)
+                {
+                    rotate_up(depth - 1);
+                    rotate_up(depth - 1);
+                }
+                else
+                {
+                    rotate_up(depth);
+                    rotate_up(depth - 1);
+                }
+                depth -= 2;
+            }
+            else
+            {
+                rotate_up(depth);
+                depth -= 1;
+            }
+        }
+    }
+
+    // Moves the last node of `path` down below every child of a higher
+    // level, or all the way to at most one child when `to_bottom` is set.
+    // `path` is extended to keep holding the links down to the node.
+    void sink(bool to_bottom)
+    {
+        Node** link = path.back();
+        Node* node = *link;
+        while (node->left || node->right)
+        {
+            Node* heavier = node->left;
+            if (!heavier || (node->right && level(node->right->weight) > level(heavier->weight)))
+                heavier = node->right;
+
+            if (to_bottom)
+            {
+                if (!node->left || !node->right)
+                    break;
+            }
+            else if (level(heavier->weight) <= level(node->weight))
+                break;
+
+            if (heavier == node->left)
+            {
+                node->left = heavier->right;
+                heavier->right = node;
+                *link = heavier;
+                link = &heavier->right;
+            }
+            else
+            {
+                node->right = heavier->left;
+                heavier->left = node;
+                *link = heavier;
+                link = &heavier->left;
+            }
+            path.push_back(link);
+        }
+    }
+
+    int height_(const Node* node) const
+    {
+        if (!node)
+            return 0;
+        int left = (node->left) ? height_(node->left) : 0;
+        int right = (node->right) ? height_(node->right) : 0;
+        return  std::max(left + 1, right + 1);
+    }
+}; // class WeightedTree
+
+} // namespace splay
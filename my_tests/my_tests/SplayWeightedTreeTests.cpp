@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+#include "SplayWeightedTree.h"
+#include "TestRandom.h"
+
+#include <climits>
+#include <set>
+#include <vector>
+
+namespace
+{
+    // Bit width of the weight, as WeightedTree buckets it.
+    int Level(std::uint32_t weight)
+    {
+        int level = 0;
+        for (; weight; weight >>= 1)
+            ++level;
+        return level;
+    }
+
+    // Checks key order and weight level heap order below `node`.
+    bool IsValid(const splay::WeightedNode* node, long long low, long long high)
+    {
+        if (!node)
+            return true;
+        if (node->number <= low || node->number >= high)
+            return false;
+        if (node->left && Level(node->left->weight) > Level(node->weight))
+            return false;
+        if (node->right && Level(node->right->weight) > Level(node->weight))
+            return false;
+        return IsValid(node->left, low, node->number) && IsValid(node->right, node->number, high);
+    }
+
+    bool IsValid(splay::WeightedTree& tree)
+    {
+        return IsValid(tree.get_root(), LLONG_MIN, LLONG_MAX);
+    }
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+TEST(SplayWeightedTree, EmptyTree)
+{
+    splay::WeightedTree tree;
+    EXPECT_EQ(nullptr, tree.get_root());
+    EXPECT_EQ(0, tree.height());
+    EXPECT_EQ(nullptr, tree.search(0));
+    EXPECT_FALSE(tree.erase(0));
+    EXPECT_FALSE(tree.set_weight(0, 1));
+    EXPECT_EQ(-1, tree.depth(0));
+}
+
+// ------------------------------------------------------------------------
+//   (1)                (3)
+//     \                /
+//     (2)  ==(3)==>  (2)
+//       \            /
+//       (3)        (1)
+TEST(SplayWeightedTree, EqualWeightsSplay)
+{
+    splay::WeightedTree tree;
+    for (const auto n : { 3, 2, 1 })
+    {
+        EXPECT_TRUE(tree.insert(n));
+        EXPECT_FALSE(tree.insert(n));
+        EXPECT_EQ(n, tree.get_root()->number);
+    }
+    EXPECT_EQ(3, tree.height());
+    EXPECT_EQ(2u, tree.splay_depth());
+
+    splay::WeightedNode* result = tree.search(3);
+    EXPECT_NE(nullptr, result);
+    EXPECT_EQ(result, tree.get_root());
+    EXPECT_EQ(4u, tree.splay_depth());
+    EXPECT_EQ(3, tree.height());
+
+    EXPECT_EQ(nullptr, tree.search(0));
+    EXPECT_EQ(1, tree.get_root()->number);
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayWeightedTree, HotKeysSurviveColdBurst)
+{
+    // Initialization
+    splay::WeightedTree tree;
+    const std::vector<int> hot{ 500, 123, 877 };
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_TRUE(tree.insert(i));
+    EXPECT_TRUE(tree.set_weight(500, 8));
+    EXPECT_TRUE(tree.set_weight(123, 4));
+    EXPECT_TRUE(tree.set_weight(877, 1));
+    EXPECT_TRUE(IsValid(tree));
+
+    // -----------------
+    for (int i = 0; i < 1000; ++i)
+    {
+        tree.search((i * 7) % 1000);
+        tree.insert(1000 + i);
+    }
+    EXPECT_TRUE(IsValid(tree));
+    EXPECT_EQ(500, tree.get_root()->number);
+    EXPECT_EQ(0, tree.depth(500));
+    EXPECT_EQ(1, tree.depth(123));
+    EXPECT_GE(2, tree.depth(877));
+
+    // cooling a key down lets the others take its place
+    EXPECT_TRUE(tree.set_weight(500, 0));
+    EXPECT_TRUE(IsValid(tree));
+    EXPECT_EQ(123, tree.get_root()->number);
+    EXPECT_TRUE(tree.contains(500));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayWeightedTree, CompareWithStdSet)
+{
+    splay::WeightedTree tree;
+    std::set<int> expected;
+    test::Random random(777u);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int key = static_cast<int>(random.next(1000));
+        const std::uint32_t weight = random.next(4);
+        switch (random.next(4))
+        {
+        case 0:
+            EXPECT_EQ(expected.insert(key).second, tree.insert(key, weight));
+            break;
+        case 1:
+            EXPECT_EQ(expected.count(key) == 1, tree.search(key) != nullptr);
+            break;
+        case 2:
+            EXPECT_EQ(expected.count(key) == 1, tree.set_weight(key, weight));
+            break;
+        default:
+            EXPECT_EQ(expected.erase(key) == 1, tree.erase(key));
+            break;
+        }
+    }
+    EXPECT_TRUE(IsValid(tree));
+    for (int key = 0; key < 1000; ++key)
+        EXPECT_EQ(expected.count(key) == 1, tree.contains(key));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayWeightedTree, ManyWeightsStayShallow)
+{
+    // Initialization
+    // weight = key: every key is heavier than all smaller keys, but they
+    // fall into only 15 levels
+    const int count{ 20000 };
+    splay::WeightedTree tree;
+    for (int i = 1; i <= count; ++i)
+        EXPECT_TRUE(tree.insert(i, static_cast<std::uint32_t>(i)));
+    EXPECT_TRUE(IsValid(tree));
+
+    // -----------------
+    // one level-1 key below 14 levels: searching it splays every segment
+    // above it, so afterwards only one node per level stays on its path
+    EXPECT_NE(nullptr, tree.search(1));
+    EXPECT_NE(nullptr, tree.search(1));
+    EXPECT_GE(14, tree.depth(1));
+
+    long long total_depth = 0;
+    test::Random random(31u);
+    for (int i = 0; i < 2000; ++i)
+    {
+        const int key = 1 + static_cast<int>(random.next(count));
+        total_depth += tree.depth(key);
+        EXPECT_NE(nullptr, tree.search(key));
+    }
+    EXPECT_TRUE(IsValid(tree));
+    EXPECT_GT(2000LL * 40, total_depth);
+    EXPECT_NE(nullptr, tree.search(1));
+    EXPECT_GE(14, tree.depth(1));
+}
+
+// ------------------------------------------------------------------------
+TEST(SplayWeightedTree, SortedEraseIsAmortized)
+{
+    // Initialization
+    // ascending inserts leave a spine; erasing and reweighting in key
+    // order must splay what they walk, or every call walks the spine
+    const int count{ 20000 };
+    for (const std::uint32_t spread : { 1u, 4u })
+    {
+        splay::WeightedTree tree;
+        for (int i = 1; i <= count; ++i)
+            EXPECT_TRUE(tree.insert(i, static_cast<std::uint32_t>(i) % spread));
+
+        // -----------------
+        long long total_depth = 0;
+        for (int i = 1; i <= count; i += 2)
+        {
+            total_depth += tree.depth(i);
+            EXPECT_TRUE(tree.set_weight(i, 0));
+        }
+        EXPECT_TRUE(IsValid(tree));
+        for (int i = 1; i <= count; ++i)
+        {
+            total_depth += tree.depth(i);
+            EXPECT_TRUE(tree.erase(i));
+        }
+        EXPECT_EQ(nullptr, tree.get_root());
+        EXPECT_GT(count * 10LL, total_depth);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Pseudo-random input of the tests. Unlike the distributions of <random>,
+// a seed gives the same sequence with every compiler and standard library,
+// so a failing differential test fails the same way everywhere.
+namespace test
+{
+
+// Linear congruential generator.
+class Random
+{
+public:
+    explicit Random(unsigned seed)
+        : state(seed)
+    {
+    }
+
+    // Next value in [0, range).
+    unsigned next(unsigned range)
+    {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % range;
+    }
+
+private:
+    unsigned state;
+}; // class Random
+
+enum class Op
+{
+    Insert,
+    Search,
+    Erase
+}; // enum class Op
+
+struct Step
+{
+    Op op;
+    int key;
+}; // struct Step
+
+// `count` keys in [0, range), repeats allowed.
+inline std::vector<int> RandomKeys(std::size_t count, int range, unsigned seed)
+{
+    Random random(seed);
+    std::vector<int> keys;
+    for (std::size_t i = 0; i < count; ++i)
+        keys.push_back(static_cast<int>(random.next(range)));
+    return keys;
+}
+
+// `count` operations on keys in [0, range), the three of them equally
+// likely: the input of the differential tests against std::set.
+inline std::vector<Step> RandomSteps(std::size_t count, int range, unsigned seed)
+{
+    Random random(seed);
+    std::vector<Step> steps;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Op op = static_cast<Op>(random.next(3));
+        steps.push_back(Step{ op, static_cast<int>(random.next(range)) });
+    }
+    return steps;
+}
+
+} // namespace test
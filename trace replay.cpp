@@ -0,0 +1,278 @@
+// Replays a trace written by splay::TraceRecorder against a tree
+// configuration and reports per-operation latency percentiles.
+//
+//     trace_replay <trace file> [tree|block16|block32|block64|buffered|weighted]
+//     trace_replay <trace file> batch [size]
+//     trace_replay --zipf <trace file> [keys] [searches] [exponent]
+//
+// With `buffered` the write log merges show up as the insert/erase tail
+// latencies, and every search is a read after the preceding writes.
+//
+// Every configuration reports its splay-depth sum: levels descended by all
+// splays, counted in blocks for block*, and for buffered only by the
+// splays that reached the tree behind the log.
+//
+// `weighted` replays against splay::WeightedTree, weighting every key by
+// its number of searches in the trace, i.e. hotness known ahead of time.
+// --zipf writes a trace to compare it on: all keys inserted in random
+// order, then searches whose key ranks follow a Zipf distribution.
+//
+// `batch` replays against splay::Tree like `tree`, but runs of consecutive
+// searches go through search_batch() in groups of `size` (64 by default).
+// Every search of a group is charged the group's time over its size, so
+// only the ops/s of `search` compare with the `tree` run, not the tails.
+
+#include "my_tests/my_tests/SplayTree.h"
+#include "my_tests/my_tests/SplayBlockTree.h"
+#include "my_tests/my_tests/SplayTrace.h"
+#include "my_tests/my_tests/SplayBufferedTree.h"
+#include "my_tests/my_tests/SplayWeightedTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+using Latencies = std::vector<std::int64_t>;
+
+template <typename TreeT>
+void replay(TreeT& tree, const splay::TraceRecord* first, const splay::TraceRecord* last, Latencies (&latencies)[3])
+{
+    for (; first != last; ++first)
+    {
+        const splay::TraceRecord& record = *first;
+        const auto start = std::chrono::steady_clock::now();
+        switch (record.op)
+        {
+        case splay::TraceOp::Insert:
+            tree.insert(record.key);
+            break;
+        case splay::TraceOp::Search:
+            tree.search(record.key);
+            break;
+        case splay::TraceOp::Erase:
+            tree.erase(record.key);
+            break;
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        latencies[static_cast<int>(record.op)].push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+}
+
+template <typename TreeT>
+void replay(TreeT& tree, const std::vector<splay::TraceRecord>& records, Latencies (&latencies)[3])
+{
+    replay(tree, records.data(), records.data() + records.size(), latencies);
+}
+
+void replay_batched(splay::Tree& tree, const std::vector<splay::TraceRecord>& records, std::size_t size, Latencies (&latencies)[3])
+{
+    std::vector<int> keys;
+    std::vector<splay::Node*> results(size);
+    Latencies& searches = latencies[static_cast<int>(splay::TraceOp::Search)];
+    for (std::size_t next = 0; next < records.size();)
+    {
+        if (records[next].op != splay::TraceOp::Search)
+        {
+            replay(tree, &records[next], &records[next] + 1, latencies);
+            ++next;
+            continue;
+        }
+
+        keys.clear();
+        for (; next < records.size() && keys.size() < size && records[next].op == splay::TraceOp::Search; ++next)
+            keys.push_back(records[next].key);
+
+        const auto start = std::chrono::steady_clock::now();
+        tree.search_batch(keys.data(), keys.size(), results.data());
+        const auto stop = std::chrono::steady_clock::now();
+        const std::int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+        searches.insert(searches.end(), keys.size(), elapsed / static_cast<std::int64_t>(keys.size()));
+    }
+}
+
+void report(const char* name, Latencies& latencies)
+{
+    if (latencies.empty())
+        return;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::int64_t total = 0;
+    for (const auto latency : latencies)
+        total += latency;
+    const auto percentile = [&latencies](double p) {
+        return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+    };
+    std::cout << name
+        << ": count " << latencies.size()
+        << ", p50 " << percentile(0.5)
+        << " ns, p90 " << percentile(0.9)
+        << " ns, p99 " << percentile(0.99)
+        << " ns, p99.9 " << percentile(0.999)
+        << " ns, max " << latencies.back() << " ns"
+        << ", " << (total ? latencies.size() * 1000000000.0 / total : 0.0) << " ops/s" << std::endl;
+}
+
+// WeightedTree with the weights taken from the trace itself.
+class WeightedReplay
+{
+public:
+    explicit WeightedReplay(const std::vector<splay::TraceRecord>& records)
+    {
+        for (const auto& record : records)
+        {
+            if (record.op == splay::TraceOp::Search)
+                ++weights[record.key];
+        }
+    }
+
+    bool insert(int number)
+    {
+        const auto weight = weights.find(number);
+        return tree.insert(number, (weight != weights.end()) ? weight->second : 0);
+    }
+
+    splay::WeightedNode* search(int number)
+    {
+        return tree.search(number);
+    }
+
+    bool erase(int number)
+    {
+        return tree.erase(number);
+    }
+
+    std::uint64_t splay_depth() const
+    {
+        return tree.splay_depth();
+    }
+
+private:
+    splay::WeightedTree tree;
+    std::unordered_map<int, std::uint32_t> weights;
+}; // class WeightedReplay
+
+int write_zipf(int argc, char** argv)
+{
+    const int keys = (argc > 3) ? std::stoi(argv[3]) : 1000000;
+    const long long searches = (argc > 4) ? std::stoll(argv[4]) : 2000000;
+    const double exponent = (argc > 5) ? std::stod(argv[5]) : 1.0;
+
+    std::mt19937_64 random(42);
+    std::vector<int> order(keys);
+    for (int i = 0; i < keys; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+
+    // rank r is searched with probability proportional to 1 / r^exponent
+    std::vector<double> cumulative(keys);
+    double sum = 0;
+    for (int r = 0; r < keys; ++r)
+        cumulative[r] = (sum += 1.0 / std::pow(r + 1.0, exponent));
+
+    std::ofstream file(argv[2], std::ios::binary);
+    splay::TraceRecorder recorder(&file);
+    for (const int key : order)
+        recorder.record(splay::TraceOp::Insert, key);
+    std::uniform_real_distribution<double> uniform(0, sum);
+    for (long long i = 0; i < searches; ++i)
+    {
+        const auto rank = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+        recorder.record(splay::TraceOp::Search, order[std::min<std::ptrdiff_t>(rank, keys - 1)]);
+    }
+    recorder.flush();
+    return file ? 0 : 1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || (std::string(argv[1]) == "--zipf" && argc < 3))
+    {
+        std::cerr << "usage: " << argv[0] << " <trace file> [tree|block16|block32|block64|buffered|weighted]" << std::endl
+            << "       " << argv[0] << " <trace file> batch [size]" << std::endl
+            << "       " << argv[0] << " --zipf <trace file> [keys] [searches] [exponent]" << std::endl;
+        return 2;
+    }
+    if (std::string(argv[1]) == "--zipf")
+        return write_zipf(argc, argv);
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<splay::TraceRecord> records;
+    if (!splay::read_trace(file, records))
+    {
+        std::cerr << "malformed trace: " << argv[1] << " (" << records.size() << " records decoded)" << std::endl;
+        return 1;
+    }
+
+    const std::string config = (argc > 2) ? argv[2] : "tree";
+    Latencies latencies[3];
+    std::uint64_t splay_depth = 0;
+    if (config == "tree")
+    {
+        splay::Tree tree;
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else if (config == "batch")
+    {
+        const std::size_t size = (argc > 3) ? std::max(std::stoi(argv[3]), 1) : 64;
+        splay::Tree tree;
+        replay_batched(tree, records, size, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else if (config == "block16")
+    {
+        splay::BlockTree<16> tree;
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else if (config == "block32")
+    {
+        splay::BlockTree<32> tree;
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else if (config == "block64")
+    {
+        splay::BlockTree<64> tree;
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else if (config == "buffered")
+    {
+        splay::BufferedTree<int> tree;
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+        std::cout << "log merges: " << tree.merges() << std::endl;
+    }
+    else if (config == "weighted")
+    {
+        WeightedReplay tree(records);
+        replay(tree, records, latencies);
+        splay_depth = tree.splay_depth();
+    }
+    else
+    {
+        std::cerr << "unknown tree configuration: " << config << std::endl;
+        return 2;
+    }
+
+    std::cout << "splay depth sum: " << splay_depth << std::endl;
+    std::cout << "records: " << records.size() << std::endl;
+    report("insert", latencies[static_cast<int>(splay::TraceOp::Insert)]);
+    report("search", latencies[static_cast<int>(splay::TraceOp::Search)]);
+    report("erase", latencies[static_cast<int>(splay::TraceOp::Erase)]);
+    return 0;
+}